@@ -0,0 +1,49 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file AddressBench.cpp
+ * @date 2018
+ *
+ * Times bulk address generation with generateAddresses() against KeyPair::create().
+ * Usage: eth-crypto-address-bench [keys] [threads]
+ */
+
+#include <eth-crypto/crypto/Common.h>
+#include <eth-crypto/core/Common.h>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+using namespace dev;
+
+int main(int argc, char** argv)
+{
+	size_t const count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+	unsigned const threads = argc > 2 ? strtoul(argv[2], nullptr, 10) : 0;
+	cout << fixed << setprecision(0);
+
+	size_t const single = count / 20;
+	Timer timer;
+	for (size_t i = 0; i < single; ++i)
+		KeyPair::create();
+	cout << left << setw(32) << "KeyPair::create()" << right << setw(12) << single / timer.elapsed() << " keys/s" << endl;
+
+	Addresses addresses;
+	KeyGenStats const stats = generateAddresses(Secret::random(), count, addresses, threads);
+	cout << left << setw(32) << "generateAddresses()" << right << setw(12) << stats.keysPerSecond() << " keys/s" << endl;
+	return 0;
+}
@@ -0,0 +1,80 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file VerifyBench.cpp
+ * @date 2018
+ *
+ * Times signature verification against a known key: secp256k1_ecdsa_verify as done by
+ * dev::verify() against recovering the key and comparing it, the way verify() used to work.
+ * Usage: eth-crypto-verify-bench [signatures]
+ */
+
+#include <eth-crypto/crypto/Common.h>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+using namespace dev;
+
+namespace
+{
+
+/// Distinct signers; signatures are spread over them round-robin.
+size_t const c_signers = 64;
+
+/// Runs @a _f(i) for every signature and prints the rate. @returns false if any call failed.
+bool measure(char const* _name, size_t _count, function<bool(size_t)> const& _f)
+{
+	bool ok = true;
+	auto const start = chrono::steady_clock::now();
+	for (size_t i = 0; i < _count; ++i)
+		ok = _f(i) && ok;
+	chrono::duration<double> const elapsed = chrono::steady_clock::now() - start;
+	cout << left << setw(32) << _name << right << setw(12) << fixed << setprecision(0) << _count / elapsed.count() << " /s" << (ok ? "" : "  FAILED") << endl;
+	return ok;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	size_t const count = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000;
+
+	vector<KeyPair> signers;
+	ParsedPublics parsed;
+	for (size_t i = 0; i < c_signers; ++i)
+	{
+		signers.push_back(KeyPair::create());
+		parsed.emplace_back(signers.back().pub());
+	}
+	h256s hashes(count);
+	Signatures sigs(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		hashes[i] = h256::random();
+		sigs[i] = sign(signers[i % c_signers].secret(), hashes[i]);
+	}
+
+	bool ok = true;
+	ok = measure("recover and compare", count, [&](size_t i) { return recover(sigs[i], hashes[i]) == signers[i % c_signers].pub(); }) && ok;
+	ok = measure("verify(Public)", count, [&](size_t i) { return verify(signers[i % c_signers].pub(), sigs[i], hashes[i]); }) && ok;
+	ok = measure("verify(ParsedPublic)", count, [&](size_t i) { return verify(parsed[i % c_signers], sigs[i], hashes[i]); }) && ok;
+	ok = measure("verify(Address)", count, [&](size_t i) { return verify(signers[i % c_signers].address(), sigs[i], hashes[i]); }) && ok;
+	return ok ? 0 : 1;
+}
@@ -52,6 +52,7 @@
 #pragma warning(pop)
 #pragma GCC diagnostic pop
 #include "vector_ref.h"
+#include "SecureMemory.h"
 
 // CryptoPP defines byte in the global namespace, so must we.
 using byte = uint8_t;
@@ -73,20 +74,24 @@ using bytes = std::vector<byte>;
 using bytesRef = vector_ref<byte>;
 using bytesConstRef = vector_ref<byte const>;
 
-template <class T>
+/// A vector whose contents are wiped when they are released.
+/// With SecureAllocator the memory is also locked and the arena does the wiping.
+template <class T, class Alloc = std::allocator<T>>
 class secure_vector
 {
 public:
+    using vector_type = std::vector<T, Alloc>;
+
     secure_vector() {}
-    secure_vector(secure_vector<T> const& /*_c*/) = default;  // See https://github.com/eth-crypto/libweb3core/pull/44
+    secure_vector(secure_vector<T, Alloc> const& /*_c*/) = default;  // See https://github.com/eth-crypto/libweb3core/pull/44
     explicit secure_vector(size_t _size): m_data(_size) {}
     explicit secure_vector(size_t _size, T _item): m_data(_size, _item) {}
-    explicit secure_vector(std::vector<T> const& _c): m_data(_c) {}
+    explicit secure_vector(std::vector<T> const& _c): m_data(_c.begin(), _c.end()) {}
     explicit secure_vector(vector_ref<T> _c): m_data(_c.data(), _c.data() + _c.size()) {}
     explicit secure_vector(vector_ref<const T> _c): m_data(_c.data(), _c.data() + _c.size()) {}
-    ~secure_vector() { ref().cleanse(); }
+    ~secure_vector() { if (!AllocatorWipes<Alloc>::value) ref().cleanse(); }
 
-    secure_vector<T>& operator=(secure_vector<T> const& _c)
+    secure_vector<T, Alloc>& operator=(secure_vector<T, Alloc> const& _c)
     {
         if (&_c == this)
             return *this;
@@ -95,25 +100,28 @@ public:
         m_data = _c.m_data;
         return *this;
     }
-    std::vector<T>& writable() { clear(); return m_data; }
-    std::vector<T> const& makeInsecure() const { return m_data; }
+    vector_type& writable() { clear(); return m_data; }
+    vector_type const& makeInsecure() const { return m_data; }
 
     void clear() { ref().cleanse(); }
 
-    vector_ref<T> ref() { return vector_ref<T>(&m_data); }
-    vector_ref<T const> ref() const { return vector_ref<T const>(&m_data); }
+    vector_ref<T> ref() { return vector_ref<T>(m_data.data(), m_data.size()); }
+    vector_ref<T const> ref() const { return vector_ref<T const>(m_data.data(), m_data.size()); }
 
     size_t size() const { return m_data.size(); }
     bool empty() const { return m_data.empty(); }
 
-    void swap(secure_vector<T>& io_other) { m_data.swap(io_other.m_data); }
+    void swap(secure_vector<T, Alloc>& io_other) { m_data.swap(io_other.m_data); }
 
 private:
-    std::vector<T> m_data;
+    vector_type m_data;
 };
 
 using bytesSec = secure_vector<byte>;
 
+/// Secure bytes kept in locked memory from SecureArena::instance().
+using bytesLocked = secure_vector<byte, SecureAllocator<byte>>;
+
 // Numeric types.
 using bigint = boost::multiprecision::number<boost::multiprecision::cpp_int_backend<>>;
 using u64 =  boost::multiprecision::number<boost::multiprecision::cpp_int_backend<64, 64, boost::multiprecision::unsigned_magnitude, boost::multiprecision::unchecked, void>>;
@@ -29,6 +29,7 @@
 #include <random>
 #include <boost/functional/hash.hpp>
 #include "CommonData.h"
+#include "SecureRandom.h"
 
 namespace dev
 {
@@ -64,6 +65,9 @@ public:
 	/// Construct an empty hash.
 	FixedHash() { m_data.fill(0); }
 
+	/// Construct from raw bytes. Usable in constant expressions, see constSha3().
+	constexpr explicit FixedHash(std::array<byte, N> const& _bs): m_data(_bs) {}
+
 	/// Construct from another hash, filling with zeroes or cropping as necessary.
 	template <unsigned M> explicit FixedHash(FixedHash<M> const& _h, ConstructFromHashType _t = AlignLeft) { m_data.fill(0); unsigned c = std::min(M, N); for (unsigned i = 0; i < c; ++i) m_data[_t == AlignRight ? N - 1 - i : i] = _h[_t == AlignRight ? M - 1 - i : i]; }
 
@@ -163,8 +167,11 @@ public:
 			i = (uint8_t)std::uniform_int_distribution<uint16_t>(0, 255)(_eng);
 	}
 
+	/// Populate with random data from the calling thread's secure generator.
+	void randomize() { secureRandom(ref()); }
+
 	/// @returns a random valued object.
-	static FixedHash random() { FixedHash ret; ret.randomize(s_fixedHashEngine); return ret; }
+	static FixedHash random() { FixedHash ret; ret.randomize(); return ret; }
 
 	struct hash
 	{
@@ -297,12 +304,57 @@ public:
 	bytesConstRef ref() const { return FixedHash<T>::ref(); }
 	byte const* data() const { return FixedHash<T>::data(); }
 
-	static SecureFixedHash<T> random() { SecureFixedHash<T> ret; ret.randomize(s_fixedHashEngine); return ret; }
+	static SecureFixedHash<T> random() { SecureFixedHash<T> ret; ret.randomize(); return ret; }
 	using FixedHash<T>::firstBitSet;
 
 	void clear() { ref().cleanse(); }
 };
 
+/// A SecureFixedHash owned on the heap, in locked memory of a SecureArena.
+/// Meant for long-lived key material held in bulk, e.g. a key store: pages are locked
+/// once per arena chunk rather than per key. A moved-from object is null.
+template <unsigned T>
+class LockedFixedHash
+{
+public:
+	LockedFixedHash(): LockedFixedHash(SecureArena::instance()) {}
+	explicit LockedFixedHash(SecureArena& _arena): m_arena(&_arena), m_p(new (_arena.allocate(sizeof(SecureFixedHash<T>))) SecureFixedHash<T>()) {}
+	explicit LockedFixedHash(SecureFixedHash<T> const& _h, SecureArena& _arena = SecureArena::instance()): LockedFixedHash(_arena) { *m_p = _h; }
+	LockedFixedHash(LockedFixedHash const& _c): LockedFixedHash(*_c, *_c.m_arena) {}
+	LockedFixedHash(LockedFixedHash&& _c) noexcept: m_arena(_c.m_arena), m_p(_c.m_p) { _c.m_p = nullptr; }
+	~LockedFixedHash() { release(); }
+
+	LockedFixedHash& operator=(LockedFixedHash const& _c) { if (&_c != this) { LockedFixedHash t(_c); swap(t); } return *this; }
+	LockedFixedHash& operator=(LockedFixedHash&& _c) noexcept { if (&_c != this) { release(); m_arena = _c.m_arena; m_p = _c.m_p; _c.m_p = nullptr; } return *this; }
+
+	/// @returns false iff this was moved from.
+	explicit operator bool() const { return m_p != nullptr; }
+
+	SecureFixedHash<T> const& operator*() const { assert(m_p); return *m_p; }
+	SecureFixedHash<T> const* operator->() const { assert(m_p); return m_p; }
+
+	/// @returns the held hash for modification.
+	SecureFixedHash<T>& writable() { assert(m_p); return *m_p; }
+
+	void swap(LockedFixedHash& io_other) noexcept { std::swap(m_arena, io_other.m_arena); std::swap(m_p, io_other.m_p); }
+
+private:
+	void release() noexcept
+	{
+		if (!m_p)
+			return;
+		// SecureFixedHash holds nothing but the bytes, which the arena wipes in bulk; its
+		// destructor would only cleanse them a second time, byte by byte, so it is not run.
+		m_arena->deallocate(m_p, sizeof(SecureFixedHash<T>));
+		m_p = nullptr;
+	}
+
+	static_assert(sizeof(SecureFixedHash<T>) == sizeof(FixedHash<T>), "release() relies on SecureFixedHash holding only the bytes");
+
+	SecureArena* m_arena;
+	SecureFixedHash<T>* m_p;
+};
+
 /// Fast equality operator for h256.
 template<> inline bool FixedHash<32>::operator==(FixedHash<32> const& _other) const
 {
@@ -353,6 +405,7 @@ using h224 = FixedHash<28>;
 using h160 = FixedHash<20>;
 using h128 = FixedHash<16>;
 using h64 = FixedHash<8>;
+using h32 = FixedHash<4>;
 using h512s = std::vector<h512>;
 using h256s = std::vector<h256>;
 using h160s = std::vector<h160>;
@@ -0,0 +1,253 @@
+/*
+ * Keccak.h
+ *
+ *  (c) 2018 array.io
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "FixedHash.h"
+
+namespace dev
+{
+
+namespace keccak
+{
+
+// Keccak-f[1600] has several backends. Single inputs run on the scalar rounds, built either
+// plainly ("scalar") or with BMI1/BMI2 code generation ("scalar-bmi2"); the AVX2 and AVX-512
+// backends permute 4 or 8 states at once and only serve batches. On first use the best
+// backends the host supports are picked via CPUID, one for single inputs and one for batches.
+// The ETH_CRYPTO_KECCAK environment variable can force a backend by name, or be set to
+// "bench" to time the available ones and take the fastest.
+
+/// @returns the names of the backends this build and host can run.
+std::vector<std::string> availableBackends();
+
+/// @returns the name of the backend hashing single inputs.
+std::string activeBackend();
+
+/// @returns the name of the backend used by sha3_ethash_batch().
+std::string activeBatchBackend();
+
+/// Uses backend @a _name for batched inputs, and for single inputs too unless it is batch-only.
+/// @returns false, changing nothing, if the backend is unknown or not available.
+bool selectBackend(std::string const& _name);
+
+/// Times the available backends and selects the fastest for single and for batched inputs.
+/// Takes a few milliseconds.
+void benchmarkBackends();
+
+/// Compile-time Keccak-256, the machinery behind constSha3(). Plain loops over a local
+/// state, so it is slow at run time; use sha3_ethash() there.
+namespace constant
+{
+
+constexpr uint64_t c_roundConstants[24] = {
+	0x0000000000000001, 0x0000000000008082, 0x800000000000808a, 0x8000000080008000,
+	0x000000000000808b, 0x0000000080000001, 0x8000000080008081, 0x8000000000008009,
+	0x000000000000008a, 0x0000000000000088, 0x0000000080008009, 0x000000008000000a,
+	0x000000008000808b, 0x800000000000008b, 0x8000000000008089, 0x8000000000008003,
+	0x8000000000008002, 0x8000000000000080, 0x000000000000800a, 0x800000008000000a,
+	0x8000000080008081, 0x8000000000008080, 0x0000000080000001, 0x8000000080008008
+};
+
+/// Rho offsets, in the lane order pi visits them.
+constexpr unsigned c_rotations[24] = {
+	1, 3, 6, 10, 15, 21, 28, 36, 45, 55, 2, 14, 27, 41, 56, 8, 25, 43, 62, 18, 39, 61, 20, 44
+};
+
+/// The lanes pi visits, starting from lane 1.
+constexpr unsigned c_piLanes[24] = {
+	10, 7, 11, 17, 18, 3, 5, 16, 8, 21, 24, 4, 15, 23, 19, 13, 12, 2, 20, 14, 22, 9, 6, 1
+};
+
+constexpr uint64_t rotl(uint64_t _x, unsigned _n) { return (_x << _n) | (_x >> (64 - _n)); }
+
+constexpr void permute(uint64_t (&_s)[25])
+{
+	for (unsigned r = 0; r < 24; ++r)
+	{
+		uint64_t c[5] = {};
+		for (unsigned x = 0; x < 5; ++x)
+			c[x] = _s[x] ^ _s[x + 5] ^ _s[x + 10] ^ _s[x + 15] ^ _s[x + 20];
+		for (unsigned x = 0; x < 5; ++x)
+		{
+			uint64_t d = c[(x + 4) % 5] ^ rotl(c[(x + 1) % 5], 1);
+			for (unsigned y = 0; y < 25; y += 5)
+				_s[y + x] ^= d;
+		}
+
+		uint64_t carry = _s[1];
+		for (unsigned i = 0; i < 24; ++i)
+		{
+			uint64_t next = _s[c_piLanes[i]];
+			_s[c_piLanes[i]] = rotl(carry, c_rotations[i]);
+			carry = next;
+		}
+
+		for (unsigned y = 0; y < 25; y += 5)
+		{
+			uint64_t row[5] = {_s[y], _s[y + 1], _s[y + 2], _s[y + 3], _s[y + 4]};
+			for (unsigned x = 0; x < 5; ++x)
+				_s[y + x] = row[x] ^ (~row[(x + 1) % 5] & row[(x + 2) % 5]);
+		}
+
+		_s[0] ^= c_roundConstants[r];
+	}
+}
+
+/// Keccak-256 digest as a literal type; std::array is not writable in constant expressions before C++17.
+struct Digest
+{
+	byte bytes[32];
+};
+
+constexpr Digest hash(char const* _data, size_t _size)
+{
+	size_t const rate = 136;
+	uint64_t s[25] = {};
+	size_t done = 0;
+	for (; _size - done >= rate; done += rate)
+	{
+		for (size_t i = 0; i < rate; ++i)
+			s[i / 8] ^= uint64_t(byte(_data[done + i])) << (8 * (i % 8));
+		permute(s);
+	}
+	size_t const tail = _size - done;
+	for (size_t i = 0; i < tail; ++i)
+		s[i / 8] ^= uint64_t(byte(_data[done + i])) << (8 * (i % 8));
+	s[tail / 8] ^= uint64_t(0x01) << (8 * (tail % 8));
+	s[(rate - 1) / 8] ^= uint64_t(0x80) << (8 * ((rate - 1) % 8));
+	permute(s);
+
+	Digest ret = {};
+	for (size_t i = 0; i < 32; ++i)
+		ret.bytes[i] = byte(s[i / 8] >> (8 * (i % 8)));
+	return ret;
+}
+
+/// @returns the first M bytes of @a _d as a FixedHash.
+template <unsigned M, size_t... I>
+constexpr FixedHash<M> prefix(Digest const& _d, std::index_sequence<I...>)
+{
+	return FixedHash<M>(std::array<byte, M>{{_d.bytes[I]...}});
+}
+
+}
+
+}
+
+/// Keccak-256 of @a _size chars at @a _data, equal to sha3_ethash() of the same bytes.
+/// Computed by the compiler when used in a constant expression, e.g.
+/// constexpr h256 c_transferTopic = constSha3("Transfer(address,address,uint256)");
+constexpr h256 constSha3(char const* _data, size_t _size)
+{
+	return keccak::constant::prefix<32>(keccak::constant::hash(_data, _size), std::make_index_sequence<32>());
+}
+
+/// Keccak-256 of string literal @a _s, without its terminating zero.
+template <size_t N>
+constexpr h256 constSha3(char const (&_s)[N])
+{
+	return constSha3(_s, N - 1);
+}
+
+/// ABI function selector: the first four bytes of the Keccak-256 of signature @a _s,
+/// e.g. constSelector("transfer(address,uint256)") is a9059cbb.
+template <size_t N>
+constexpr h32 constSelector(char const (&_s)[N])
+{
+	return keccak::constant::prefix<4>(keccak::constant::hash(_s, N - 1), std::make_index_sequence<4>());
+}
+
+/// "Transfer(address,address,uint256)"_sha3 is constSha3("Transfer(address,address,uint256)").
+constexpr h256 operator"" _sha3(char const* _s, size_t _size)
+{
+	return constSha3(_s, _size);
+}
+
+/// "transfer(address,uint256)"_selector is constSelector("transfer(address,uint256)").
+constexpr h32 operator"" _selector(char const* _s, size_t _size)
+{
+	return keccak::constant::prefix<4>(keccak::constant::hash(_s, _size), std::make_index_sequence<4>());
+}
+
+/**
+ * @brief Incremental Keccak-256, the hash Ethereum calls sha3 (see sha3_ethash).
+ * Input is absorbed as it arrives, so data spread over several buffers can be hashed
+ * without being concatenated first. Never allocates.
+ */
+class Keccak256
+{
+public:
+	Keccak256() { reset(); }
+
+	/// Absorbs @a _data.
+	Keccak256& update(bytesConstRef _data);
+
+	/// Absorbs the bytes of @a _h.
+	template <unsigned N> Keccak256& update(FixedHash<N> const& _h) { return update(_h.ref()); }
+
+	/// @returns the hash of everything absorbed since construction or the last reset(),
+	/// and resets the hasher.
+	h256 final();
+
+	/// Discards everything absorbed so far.
+	void reset();
+
+private:
+	static size_t const c_rate = 136;
+
+	uint64_t m_state[25];
+	byte m_buffer[c_rate];
+	size_t m_buffered;	///< Bytes in m_buffer not absorbed yet.
+};
+
+namespace keccak
+{
+
+/// Permutes the 25-word state @a io_state, which holds one padded block, and
+/// @returns its Keccak-256 digest.
+h256 squeezeBlock(uint64_t* io_state);
+
+/// Keccak-256 of the N bytes at @a _data for N shorter than a block. The block is
+/// built straight in the state with the padding folded in at compile time, then
+/// permuted once.
+template <unsigned N>
+h256 hashFixed(byte const* _data, std::true_type)
+{
+	uint64_t s[25] = {};
+	for (unsigned w = 0; w < N / 8; ++w)
+		for (unsigned i = 0; i < 8; ++i)
+			s[w] |= uint64_t(_data[8 * w + i]) << (8 * i);
+	for (unsigned i = 0; i < N % 8; ++i)
+		s[N / 8] |= uint64_t(_data[N / 8 * 8 + i]) << (8 * i);
+	s[N / 8] ^= uint64_t(0x01) << (8 * (N % 8));
+	s[16] ^= uint64_t(0x80) << 56;
+	return squeezeBlock(s);
+}
+
+/// Keccak-256 of the N bytes at @a _data for N of a block or more.
+template <unsigned N>
+h256 hashFixed(byte const* _data, std::false_type)
+{
+	return Keccak256().update(bytesConstRef(_data, N)).final();
+}
+
+/// Keccak-256 of the N bytes at @a _data, N known at compile time.
+template <unsigned N>
+h256 hashFixed(byte const* _data)
+{
+	return hashFixed<N>(_data, std::integral_constant<bool, (N < 136)>());
+}
+
+}
+
+}
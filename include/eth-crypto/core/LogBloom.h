@@ -0,0 +1,130 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file LogBloom.h
+ * @date 2018
+ *
+ * Log blooms: building them and indexing them over ranges of blocks.
+ */
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include <eth-crypto/core/Address.h>
+
+namespace dev
+{
+
+/// The bloom of a receipt or block: 2048 bits, three set for each address and topic.
+using LogBloom = h2048;
+using LogBlooms = std::vector<LogBloom>;
+
+/// The three bits of a LogBloom set for an entry, as indices into its 2048 bits,
+/// counted from the last byte like bloomPart<3, 256>().
+using BloomBits = std::array<uint16_t, 3>;
+
+/// @returns the bloom bits of the entry with Keccak-256 hash @a _hash.
+BloomBits bloomBitsOfHash(h256 const& _hash);
+
+/// @returns the bloom bits of @a _entry, an address or a topic.
+BloomBits bloomBits(bytesConstRef _entry);
+template <unsigned N> BloomBits bloomBits(FixedHash<N> const& _entry) { return bloomBits(_entry.ref()); }
+
+/// Sets @a _bits in @a io_bloom.
+void setBloomBits(LogBloom& io_bloom, BloomBits const& _bits);
+
+/// @returns true if all of @a _bits are set in @a _bloom.
+bool hasBloomBits(LogBloom const& _bloom, BloomBits const& _bits);
+
+/// ORs @a _bloom into @a io_bloom a machine word at a time.
+void orBloom(LogBloom& io_bloom, LogBloom const& _bloom);
+
+/**
+ * @brief Builds a LogBloom from many addresses and topics.
+ * Entries are queued and hashed together with sha3_ethash_batch() when the bloom is
+ * asked for; each then sets its three bits directly, without building a bloom per entry.
+ */
+class LogBloomBuilder
+{
+public:
+	/// Adds the address of a log.
+	LogBloomBuilder& add(Address const& _address) { m_addresses.push_back(_address); return *this; }
+
+	/// Adds a topic of a log.
+	LogBloomBuilder& add(h256 const& _topic) { m_topics.push_back(_topic); return *this; }
+
+	/// Adds all entries of @a _bloom, e.g. a receipt bloom when building a block bloom.
+	LogBloomBuilder& add(LogBloom const& _bloom) { orBloom(m_bloom, _bloom); return *this; }
+
+	/// @returns the bloom of everything added so far.
+	LogBloom const& bloom();
+
+	/// Starts over with an empty bloom.
+	void clear();
+
+private:
+	Addresses m_addresses;	///< Not hashed yet.
+	h256s m_topics;			///< Not hashed yet.
+	LogBloom m_bloom;
+};
+
+/// Filter over blooms: matches if every group does, a group matching if any of its
+/// entries does, e.g. {{addresses}, {topic 0 values}, {topic 1 values}}. An empty
+/// group matches anything.
+using BloomFilter = std::vector<std::vector<BloomBits>>;
+
+/// @returns true if @a _bloom may contain logs matching @a _filter.
+bool bloomMatches(LogBloom const& _bloom, BloomFilter const& _filter);
+
+/**
+ * @brief Bit-sliced index of the blooms of consecutive blocks.
+ * Blocks are grouped into sections; for each of the 2048 bloom bits, a section keeps
+ * one bit per block. A query ANDs and ORs whole rows, 64 blocks per word, and only
+ * looks at the rows of the bits the filter names, instead of scanning every bloom.
+ */
+class BloomIndex
+{
+public:
+	static unsigned const c_defaultSectionSize = 4096;
+
+	/// @a _sectionSize blocks per section, rounded up to a multiple of 64.
+	explicit BloomIndex(uint64_t _firstBlock = 0, unsigned _sectionSize = c_defaultSectionSize);
+
+	/// Adds the bloom of the next block.
+	void append(LogBloom const& _bloom);
+
+	/// @returns the number of the first block.
+	uint64_t firstBlock() const { return m_firstBlock; }
+
+	/// @returns the number of blocks indexed.
+	uint64_t size() const { return m_size; }
+
+	/// @returns the numbers of the blocks in [@a _from, @a _to] whose blooms may match
+	/// @a _filter, in ascending order.
+	std::vector<uint64_t> matches(BloomFilter const& _filter, uint64_t _from, uint64_t _to) const;
+
+	/// Drops all blocks.
+	void clear() { m_rows.clear(); m_size = 0; }
+
+private:
+	unsigned m_sectionWords;		///< 64 bit words per row of a section.
+	uint64_t m_firstBlock;
+	uint64_t m_size = 0;
+	std::vector<uint64_t> m_rows;	///< Per section, 2048 rows of m_sectionWords words each.
+};
+
+}
@@ -0,0 +1,125 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file MemoryTrie.h
+ * @date 2018
+ *
+ * Merkle-Patricia trie held in memory, for state roots.
+ */
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include <eth-crypto/core/TrieCommon.h>
+
+namespace dev
+{
+
+class RLPStream;
+
+/**
+ * @brief Merkle-Patricia trie over h256 keys, kept in memory.
+ * Nodes live in one contiguous arena and are recycled through free lists; values are
+ * stored back to back in a single buffer. Changes only mark the nodes on their path
+ * dirty, so root() rehashes just those and reuses the hashes of everything else.
+ * Dirty children of a branch are rehashed on several threads when there are many.
+ * Not thread safe.
+ */
+class MemoryTrie
+{
+public:
+	/// Sets the value under @a _key to @a _value. An empty value removes the key.
+	void insert(h256 const& _key, bytesConstRef _value);
+	void insert(h256 const& _key, bytes const& _value) { insert(_key, &_value); }
+
+	/// Removes @a _key.
+	/// @returns false if it was not there.
+	bool remove(h256 const& _key);
+
+	/// @returns the value under @a _key, empty if there is none.
+	/// Valid until the trie is next changed.
+	bytesConstRef at(h256 const& _key) const;
+
+	/// @returns true if @a _key has a value.
+	bool contains(h256 const& _key) const { return !at(_key).empty(); }
+
+	/// @returns the number of keys.
+	size_t size() const { return m_size; }
+
+	/// @returns the root hash, rehashing the nodes changed since the last call on up to
+	/// @a _threads threads, zero meaning one per hardware thread.
+	h256 root(unsigned _threads = 0);
+
+	/// @returns the number of nodes the next root() will hash.
+	size_t dirtyNodes() const { return m_dirty; }
+
+	/// Removes all keys.
+	void clear();
+
+private:
+	using NodeIndex = uint32_t;
+	static NodeIndex const c_null = NodeIndex(-1);
+
+	enum class Kind: byte { Free, Leaf, Extension, Branch };
+
+	struct Node
+	{
+		h256 key;					///< A key under this node; its nibbles [begin, end) are the node's path.
+		h256 ref;					///< How the parent refers to this node once hashed.
+		Kind kind = Kind::Free;
+		bool dirty = true;
+		byte begin = 0;
+		byte end = 0;				///< 64 for a leaf, where the child starts for an extension.
+		byte refSize = 0;			///< 32 if ref is the node's hash, else the size of its RLP in ref.
+		NodeIndex link = c_null;	///< Child of an extension, children of a branch, next free node.
+		uint32_t valueOffset = 0;	///< Where the value of a leaf is in m_values.
+		uint32_t valueSize = 0;
+	};
+
+	using Children = std::array<NodeIndex, 16>;
+
+	NodeIndex newNode(Kind _kind, h256 const& _key, unsigned _begin, unsigned _end);
+	NodeIndex newLeaf(h256 const& _key, unsigned _begin, bytesConstRef _value);
+	NodeIndex newBranch(h256 const& _key, unsigned _begin);
+	void freeNode(NodeIndex _n);
+	void markDirty(NodeIndex _n);
+	Children& children(NodeIndex _n) { return m_branches[m_nodes[_n].link]; }
+	Children const& children(NodeIndex _n) const { return m_branches[m_nodes[_n].link]; }
+
+	void setValue(NodeIndex _n, bytesConstRef _value);
+	bytesConstRef value(Node const& _n) const { return bytesConstRef(m_values.data() + _n.valueOffset, _n.valueSize); }
+	void compactValues();
+
+	NodeIndex insertAt(NodeIndex _n, h256 const& _key, unsigned _pos, bytesConstRef _value);
+	NodeIndex removeAt(NodeIndex _n, h256 const& _key, unsigned _pos);
+
+	void hashNode(NodeIndex _n, unsigned _threads);
+	void hashChildren(NodeIndex _n, unsigned _threads);
+	void appendRef(RLPStream& _s, NodeIndex _n) const;
+
+	std::vector<Node> m_nodes;
+	std::vector<Children> m_branches;
+	NodeIndex m_freeNodes = c_null;				///< Head of the list of free nodes.
+	std::vector<NodeIndex> m_freeBranches;
+	bytes m_values;
+	size_t m_garbage = 0;						///< Bytes of m_values no longer used.
+	NodeIndex m_root = c_null;
+	size_t m_size = 0;
+	size_t m_dirty = 0;
+};
+
+}
@@ -28,14 +28,18 @@
 #include <exception>
 #include <iosfwd>
 #include <iomanip>
+#include <type_traits>
+#include <boost/container/small_vector.hpp>
 #include "vector_ref.h"
 #include "Exceptions.h"
 #include "FixedHash.h"
+#include "Keccak.h"
 
 namespace dev
 {
 
 class RLP;
+class RLPIndex;
 using RLPs = std::vector<RLP>;
 
 template <class _T> struct intTraits { static const unsigned maxSize = sizeof(_T); };
@@ -70,6 +74,7 @@ public:
 		ThrowOnFail = 4,
 		FailIfTooBig = 8,
 		FailIfTooSmall = 16,
+		Trusted = 32,			///< Already validated, e.g. by RLPTape; skips all structural checks.
 		Strict = ThrowOnFail | FailIfTooBig,
 		VeryStrict = ThrowOnFail | FailIfTooBig | FailIfTooSmall,
 		LaissezFaire = AllowNonCanon
@@ -137,9 +142,12 @@ public:
 
 	/// Subscript operator.
 	/// @returns the list item @a _i if isList() and @a _i < listItems(), or RLP() otherwise.
-	/// @note if used to access items in ascending order, this is efficient.
+	/// @note if used to access items in ascending order, this is efficient. Use indexed() otherwise.
 	RLP operator[](size_t _i) const;
 
+	/// @returns an offset table over the list items, for repeated or out-of-order access.
+	RLPIndex indexed() const;
+
 	using element_type = RLP;
 
 	/// @brief Iterator class for iterating through items of RLP list.
@@ -153,7 +161,7 @@ public:
 
 		iterator& operator++();
 		iterator operator++(int) { auto ret = *this; operator++(); return ret; }
-		RLP operator*() const { return RLP(m_currentItem); }
+		RLP operator*() const { return RLP(m_currentItem, m_trusted ? Trusted : VeryStrict); }
 		bool operator==(iterator const& _cmp) const { return m_currentItem == _cmp.m_currentItem; }
 		bool operator!=(iterator const& _cmp) const { return !operator==(_cmp); }
 
@@ -163,6 +171,7 @@ public:
 
 		size_t m_remaining = 0;
 		bytesConstRef m_currentItem;
+		bool m_trusted = false;
 	};
 
 	/// @brief Iterator into beginning of sub-item list (valid only if we are a list).
@@ -332,6 +341,8 @@ public:
 	size_t actualSize() const;
 
 private:
+	friend class RLPIndex;
+
 	/// Disable construction from rvalue
 	explicit RLP(bytes const&&) {}
 
@@ -354,11 +365,17 @@ private:
 	size_t items() const;
 
 	/// @returns the size encoded into the RLP in @a _data and throws if _data is too short.
-	static size_t sizeAsEncoded(bytesConstRef _data) { return RLP(_data, ThrowOnFail | FailIfTooSmall).actualSize(); }
+	static size_t sizeAsEncoded(bytesConstRef _data, Strictness _s = ThrowOnFail | FailIfTooSmall) { return RLP(_data, _s).actualSize(); }
+
+	/// @returns the strictness to read our items with.
+	Strictness itemStrictness() const { return m_trusted ? Trusted : ThrowOnFail | FailIfTooSmall; }
 
 	/// Our byte data.
 	bytesConstRef m_data;
 
+	/// Whether m_data is known to be well-formed.
+	bool m_trusted = false;
+
 	/// The list-indexing cache.
 	mutable size_t m_lastIndex = (size_t)-1;
 	mutable size_t m_lastEnd = 0;
@@ -384,6 +401,162 @@ template <class T, size_t N> struct Converter<std::array<T, N>> { static std::ar
 
 template <class T> inline T RLP::convert(int _flags) const { return Converter<T>::convert(*this, _flags); }
 
+/**
+ * @brief Offset table over the items of an RLP list, built in a single walk of the list.
+ *
+ * Gives constant-time item access, count and iteration, where RLP::operator[] rescans the
+ * list from the start for every step backwards and itemCount() rescans it on every call.
+ * Only references the list's data, which must outlive the index.
+ */
+class RLPIndex
+{
+public:
+	/// @brief Iterator over the indexed items.
+	class iterator
+	{
+	public:
+		using value_type = RLP;
+		using element_type = RLP;
+
+		iterator(RLPIndex const& _index, size_t _i): m_index(&_index), m_i(_i) {}
+
+		iterator& operator++() { ++m_i; return *this; }
+		iterator operator++(int) { auto ret = *this; ++m_i; return ret; }
+		RLP operator*() const { return (*m_index)[m_i]; }
+		bool operator==(iterator const& _cmp) const { return m_i == _cmp.m_i; }
+		bool operator!=(iterator const& _cmp) const { return m_i != _cmp.m_i; }
+
+	private:
+		RLPIndex const* m_index;
+		size_t m_i;
+	};
+
+	/// Construct an empty index.
+	RLPIndex() {}
+
+	/// Indexes the items of @a _list, which is empty if @a _list isn't a list.
+	/// Throws if an item runs past the end of the list.
+	explicit RLPIndex(RLP const& _list);
+
+	/// @returns the number of items.
+	size_t size() const { return m_items.size(); }
+	bool empty() const { return m_items.empty(); }
+
+	/// @returns the item @a _i, or RLP() if @a _i >= size().
+	RLP operator[](size_t _i) const { return _i < m_items.size() ? RLP(m_payload.cropped(m_items[_i].offset, m_items[_i].size), m_itemStrictness) : RLP(); }
+
+	iterator begin() const { return iterator(*this, 0); }
+	iterator end() const { return iterator(*this, m_items.size()); }
+
+private:
+	struct Item
+	{
+		size_t offset;	///< Into the list payload.
+		size_t size;	///< Of the whole encoded item.
+	};
+
+	/// Transactions have nine fields and trie branches seventeen; longer lists go to the heap.
+	static const size_t c_inlineItems = 17;
+
+	bytesConstRef m_payload;
+	RLP::Strictness m_itemStrictness = RLP::LaissezFaire;
+	boost::container::small_vector<Item, c_inlineItems> m_items;
+};
+
+/**
+ * @brief An integer RLP encoded at compile time, for constants appended often:
+ * constexpr RLPInt c_v27(27); ... _s << c_v27;
+ */
+class RLPInt
+{
+public:
+	constexpr explicit RLPInt(uint64_t _i): m_data{}, m_size(1)
+	{
+		if (_i && _i < c_rlpDataImmLenStart)
+			m_data[0] = byte(_i);
+		else
+		{
+			unsigned len = 0;
+			for (uint64_t v = _i; v; v >>= 8)
+				++len;
+			m_data[0] = byte(c_rlpDataImmLenStart + len);
+			for (unsigned i = 0; i < len; ++i)
+				m_data[len - i] = byte(_i >> (8 * i));
+			m_size = 1 + len;
+		}
+	}
+
+	/// @returns the encoding.
+	bytesConstRef ref() const { return bytesConstRef(m_data, m_size); }
+
+private:
+	byte m_data[1 + sizeof(uint64_t)];
+	unsigned m_size;
+};
+
+/**
+ * @brief Destination of an RLPStream's output other than its own buffer.
+ * A stream with a sink hands every completed top-level item to it and then reuses its
+ * buffer, so only the item being encoded is ever held by the stream.
+ */
+class RLPSink
+{
+public:
+	virtual ~RLPSink() {}
+
+	/// Takes the RLP @a _rlp.
+	/// @returns false, taking nothing, if there is no room for it.
+	virtual bool put(bytesConstRef _rlp) = 0;
+};
+
+/// Writes into a fixed buffer owned by the caller.
+class RLPBufferSink: public RLPSink
+{
+public:
+	explicit RLPBufferSink(bytesRef _buffer): m_buffer(_buffer) {}
+
+	bool put(bytesConstRef _rlp) override;
+
+	/// @returns the part of the buffer written so far.
+	bytesConstRef written() const { return m_buffer.cropped(0, m_size); }
+
+	/// @returns true if some output did not fit and was dropped.
+	bool overflowed() const { return m_overflow; }
+
+	/// Starts over at the beginning of the buffer.
+	void reset() { m_size = 0; m_overflow = false; }
+
+private:
+	bytesRef m_buffer;
+	size_t m_size = 0;
+	bool m_overflow = false;
+};
+
+/// Appends to a byte array owned by the caller, e.g. scratch space reused for many objects.
+class RLPArenaSink: public RLPSink
+{
+public:
+	explicit RLPArenaSink(bytes& _arena): m_arena(_arena) {}
+
+	bool put(bytesConstRef _rlp) override { m_arena.insert(m_arena.end(), _rlp.begin(), _rlp.end()); return true; }
+
+private:
+	bytes& m_arena;
+};
+
+/// Hashes the output with Keccak-256 instead of keeping it.
+class RLPHashSink: public RLPSink
+{
+public:
+	bool put(bytesConstRef _rlp) override { m_hasher.update(_rlp); return true; }
+
+	/// @returns sha3_ethash() of everything put so far, and starts over.
+	h256 hash() { return m_hasher.final(); }
+
+private:
+	Keccak256 m_hasher;
+};
+
 /**
  * @brief Class for writing to an RLP bytestream.
  */
@@ -396,13 +569,21 @@ public:
 	/// Initializes the RLPStream as a list of @a _listItems items.
 	explicit RLPStream(size_t _listItems) { appendList(_listItems); }
 
+	/// Initializes an RLPStream handing its output to @a _sink, which must outlive it.
+	/// Output that does not fit into the sink is dropped and reported by overflowed().
+	explicit RLPStream(RLPSink& _sink): m_sink(&_sink) {}
+
 	~RLPStream() {}
 
 	/// Append given datum to the byte stream.
-	RLPStream& append(unsigned _s) { return append(bigint(_s)); }
-	RLPStream& append(u160 _s) { return append(bigint(_s)); }
-	RLPStream& append(u256 _s) { return append(bigint(_s)); }
+	/// Built-in integers, u160 and u256 are encoded from their machine words directly.
+	/// @throws RLPException for negative values, which RLP cannot encode.
+	template <class T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+	RLPStream& append(T _s) { return appendInt(nonNegative(_s, std::is_signed<T>())); }
+	RLPStream& append(u160 const& _s) { return appendLimbs(_s.backend().limbs(), _s.backend().size()); }
+	RLPStream& append(u256 const& _s) { return appendLimbs(_s.backend().limbs(), _s.backend().size()); }
 	RLPStream& append(bigint _s);
+	RLPStream& append(RLPInt const& _i) { return appendRaw(_i.ref()); }
 	RLPStream& append(bytesConstRef _s, bool _compact = false);
 	RLPStream& append(bytes const& _s) { return append(bytesConstRef(&_s)); }
 	RLPStream& append(std::string const& _s) { return append(bytesConstRef(_s)); }
@@ -434,7 +615,11 @@ public:
 	template <class T> RLPStream& operator<<(T _data) { return append(_data); }
 
 	/// Clear the output stream so far.
-	void clear() { m_out.clear(); m_listStack.clear(); }
+	void clear() { m_out.clear(); m_listStack.clear(); m_gaps.clear(); m_gapBytes = 0; }
+
+	/// Reserves room for @a _bytes of output and @a _lists nested lists, so that encoding
+	/// up to that much does not allocate.
+	void reserve(size_t _bytes, size_t _lists = 0) { m_out.reserve(_bytes); m_gaps.reserve(_lists); m_listStack.reserve(std::min<size_t>(_lists, 64)); }
 
 	/// Read the byte stream.
 	bytes const& out() const { if(!m_listStack.empty()) BOOST_THROW_EXCEPTION(RLPException() << errinfo_comment("listStack is not empty")); return m_out; }
@@ -442,12 +627,23 @@ public:
 	/// Invalidate the object and steal the output byte stream.
 	bytes&& invalidate() { if(!m_listStack.empty()) BOOST_THROW_EXCEPTION(RLPException() << errinfo_comment("listStack is not empty")); return std::move(m_out); }
 
+	/// @returns true if output was dropped because the sink had no room for it.
+	bool overflowed() const { return m_overflow; }
+
 	/// Swap the contents of the output stream out for some other byte array.
 	void swapOut(bytes& _dest) { if(!m_listStack.empty()) BOOST_THROW_EXCEPTION(RLPException() << errinfo_comment("listStack is not empty")); swap(m_out, _dest); }
 
 private:
 	void noteAppended(size_t _itemCount = 1);
 
+	RLPStream& appendInt(uint64_t _i);
+
+	template <class T> static uint64_t nonNegative(T _i, std::true_type) { if (_i < 0) BOOST_THROW_EXCEPTION(RLPException() << errinfo_comment("negative integer in RLP")); return uint64_t(_i); }
+	template <class T> static uint64_t nonNegative(T _i, std::false_type) { return _i; }
+
+	/// Appends the integer of @a _count machine words at @a _limbs, least significant first.
+	RLPStream& appendLimbs(boost::multiprecision::limb_type const* _limbs, size_t _count);
+
 	/// Push the node-type byte (using @a _base) along with the item count @a _count.
 	/// @arg _count is number of characters for strings, data-bytes for ints, or items for lists.
 	void pushCount(size_t _count, byte _offset);
@@ -461,17 +657,47 @@ private:
 			*(b--) = (byte)_i;
 	}
 
+	/// Writes the headers of closed lists into place, closing their gaps.
+	void compact();
+
+	/// Hands the output to m_sink.
+	void flush();
+
+	/// A list being appended.
+	struct OpenList
+	{
+		size_t items;		///< Items still to come.
+		size_t pos;			///< Where its header slot is in m_out.
+		size_t gapBytes;	///< m_gapBytes when the list was opened.
+	};
+
+	/// Unused part of the header slot of a closed list.
+	struct Gap
+	{
+		size_t pos;
+		size_t size;
+	};
+
 	/// Our output byte stream.
 	bytes m_out;
 
-	std::vector<std::pair<size_t, size_t>> m_listStack;
+	std::vector<OpenList> m_listStack;
+
+	/// Lists get a header slot of the maximal size when opened, filled from its end when
+	/// they close; the rest stays a gap until the outermost list closes and compact()
+	/// removes all gaps in one pass. Closing a list thus never moves its payload.
+	std::vector<Gap> m_gaps;
+	size_t m_gapBytes = 0;	///< Total size of m_gaps.
+
+	RLPSink* m_sink = nullptr;
+	bool m_overflow = false;
 };
 
 template <class _T> void rlpListAux(RLPStream& _out, _T _t) { _out << _t; }
 template <class _T, class ... _Ts> void rlpListAux(RLPStream& _out, _T _t, _Ts ... _ts) { rlpListAux(_out << _t, _ts...); }
 
 /// Export a single item in RLP format, returning a byte array.
-template <class _T> bytes rlp(_T _t) { return (RLPStream() << _t).out(); }
+template <class _T> bytes rlp(_T _t) { RLPStream s; s << _t; bytes ret; s.swapOut(ret); return ret; }
 
 /// Export a list of items in RLP format, returning a byte array.
 inline bytes rlpList() { return RLPStream(0).out(); }
@@ -479,7 +705,9 @@ template <class ... _Ts> bytes rlpList(_Ts ... _ts)
 {
 	RLPStream out(sizeof ...(_Ts));
 	rlpListAux(out, _ts...);
-	return out.out();
+	bytes ret;
+	out.swapOut(ret);
+	return ret;
 }
 
 /// The empty string in RLP format.
@@ -0,0 +1,87 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file RLPTape.h
+ * @date 2018
+ *
+ * One-pass structural validation of buffers of RLP items.
+ */
+
+#pragma once
+
+#include <vector>
+#include <eth-crypto/core/RLP.h>
+
+namespace dev
+{
+
+/**
+ * @brief Structural tape of a buffer holding a sequence of RLP items, e.g. a block or a batch
+ * of raw transactions, built in a single pass over the item headers.
+ *
+ * Construction checks that the buffer is exactly a sequence of complete, canonically encoded
+ * items nested no deeper than the given limit, and throws BadRLP (UndersizeRLP for items
+ * running past their list or the buffer) otherwise. Items handed out afterwards are
+ * RLP::Trusted, so reading them repeats none of those checks.
+ * Refers to the buffer, which must outlive the tape.
+ */
+class RLPTape
+{
+public:
+	/// An item, in the order items start in the buffer: lists precede their contents.
+	struct Entry
+	{
+		size_t offset;		///< Of the item in the buffer.
+		size_t payload;		///< Offset of the item's payload in the buffer.
+		size_t end;			///< One past the item in the buffer.
+		size_t next;		///< Tape index following the item and all it contains.
+		size_t items;		///< Number of direct sub-items of a list, zero for data.
+		bool list;
+	};
+
+	/// Deeper nesting than any block or transaction needs.
+	static const unsigned c_defaultMaxDepth = 64;
+
+	/// Construct an empty tape.
+	RLPTape() {}
+
+	/// Validates @a _data, throwing if it is not a sequence of well-formed items.
+	explicit RLPTape(bytesConstRef _data, unsigned _maxDepth = c_defaultMaxDepth);
+
+	/// @returns the number of top-level items in the buffer.
+	size_t size() const { return m_top.size(); }
+	bool empty() const { return m_top.empty(); }
+
+	/// @returns top-level item @a _i, or RLP() if @a _i >= size().
+	RLP operator[](size_t _i) const { return _i < m_top.size() ? item(m_top[_i]) : RLP(); }
+
+	/// @returns the tape: every item at any depth.
+	std::vector<Entry> const& entries() const { return m_tape; }
+
+	/// @returns the item at tape index @a _entry.
+	/// Sub-items of a list entry e start at e + 1 and follow each other through Entry::next.
+	RLP item(size_t _entry) const { Entry const& e = m_tape[_entry]; return RLP(m_data.cropped(e.offset, e.end - e.offset), RLP::Trusted); }
+
+	/// @returns the tape index of top-level item @a _i.
+	size_t topEntry(size_t _i) const { return m_top[_i]; }
+
+private:
+	bytesConstRef m_data;
+	std::vector<Entry> m_tape;
+	std::vector<size_t> m_top;
+};
+
+}
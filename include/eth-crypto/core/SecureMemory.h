@@ -0,0 +1,130 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file SecureMemory.h
+ * @date 2018
+ *
+ * Locked, guard-paged memory for key material.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace dev
+{
+
+/// Overwrites @a _size bytes at @a _p with zeros in a way the compiler may not optimise away.
+void secureWipe(void* _p, size_t _size);
+
+/**
+ * @brief Memory arena for key material that is locked into RAM and fenced by guard pages.
+ * Small blocks are carved out of chunks of several pages, each of them locked once and
+ * surrounded by inaccessible pages; freed blocks are wiped and kept in per size class
+ * free lists. Blocks bigger than the largest size class get a guarded mapping of their own.
+ * Destroying an arena wipes and unmaps all of its chunks at once, whether or not the
+ * blocks in them were freed.
+ * If the OS refuses to lock memory (e.g. RLIMIT_MEMLOCK) the memory is still used,
+ * unlocked, and lockFailures() is incremented.
+ */
+class SecureArena
+{
+public:
+	static size_t const c_defaultChunkSize = 64 * 1024;
+
+	/// @returns the process-wide arena. It is never destroyed, so it outlives every
+	/// object with static storage duration that allocates from it.
+	static SecureArena& instance();
+
+	explicit SecureArena(size_t _chunkSize = c_defaultChunkSize);
+	~SecureArena();
+
+	SecureArena(SecureArena const&) = delete;
+	SecureArena& operator=(SecureArena const&) = delete;
+
+	/// @returns a block of at least @a _size bytes aligned to 16 bytes.
+	/// @throws std::bad_alloc if no memory could be mapped.
+	void* allocate(size_t _size);
+
+	/// Wipes and releases a block obtained from allocate(@a _size).
+	void deallocate(void* _p, size_t _size) noexcept;
+
+	/// @returns the number of bytes mapped for blocks.
+	size_t mappedBytes() const { return m_mapped; }
+
+	/// @returns the number of mappings that could not be locked into RAM.
+	size_t lockFailures() const { return m_lockFailures; }
+
+private:
+	struct Region
+	{
+		char* base;		///< Start of the mapping, including the leading guard page.
+		size_t size;	///< Size of the mapping, including both guard pages.
+	};
+
+	static size_t const c_classCount = 9;	///< Size classes 16, 32, ..., 4096 bytes.
+
+	/// @returns the index of the smallest size class holding @a _size bytes, or c_classCount.
+	static size_t sizeClass(size_t _size);
+
+	/// Maps @a _size usable bytes between two guard pages and locks them.
+	Region map(size_t _size);
+	void unmap(Region const& _r) noexcept;
+
+	std::mutex x_arena;
+	size_t m_chunkSize;
+	std::vector<Region> m_chunks;
+	char* m_bump = nullptr;		///< Next unused byte of the newest chunk.
+	char* m_bumpEnd = nullptr;
+	void* m_free[c_classCount] = {};	///< Intrusive free lists, one per size class.
+	std::vector<Region> m_large;
+	std::atomic<size_t> m_mapped{0};
+	std::atomic<size_t> m_lockFailures{0};
+};
+
+/// Standard allocator handing out memory from a SecureArena.
+template <class T>
+class SecureAllocator
+{
+public:
+	using value_type = T;
+
+	SecureAllocator() noexcept: m_arena(&SecureArena::instance()) {}
+	explicit SecureAllocator(SecureArena& _arena) noexcept: m_arena(&_arena) {}
+	template <class U> SecureAllocator(SecureAllocator<U> const& _o) noexcept: m_arena(&_o.arena()) {}
+
+	T* allocate(size_t _n) { return static_cast<T*>(m_arena->allocate(_n * sizeof(T))); }
+	void deallocate(T* _p, size_t _n) noexcept { m_arena->deallocate(_p, _n * sizeof(T)); }
+
+	SecureArena& arena() const { return *m_arena; }
+
+	template <class U> bool operator==(SecureAllocator<U> const& _o) const { return m_arena == &_o.arena(); }
+	template <class U> bool operator!=(SecureAllocator<U> const& _o) const { return m_arena != &_o.arena(); }
+
+private:
+	SecureArena* m_arena;
+};
+
+/// Whether an allocator wipes memory itself when it is released.
+template <class Alloc> struct AllocatorWipes { static bool const value = false; };
+template <class T> struct AllocatorWipes<SecureAllocator<T>> { static bool const value = true; };
+
+}
@@ -0,0 +1,39 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file SecureRandom.h
+ * @date 2018
+ *
+ * Per-thread cryptographically secure random number generator.
+ */
+
+#pragma once
+
+#include "CommonData.h"
+
+namespace dev
+{
+
+/// Fills @a o_out with cryptographically secure random bytes.
+/// Every thread owns a ChaCha20 generator seeded from the OS on first use and reseeded
+/// periodically and after fork(). The key is replaced after every refill, so earlier
+/// output cannot be reconstructed from the state.
+void secureRandom(bytesRef o_out);
+
+/// Mixes fresh OS entropy into the calling thread's generator.
+void reseedSecureRandom();
+
+}
@@ -0,0 +1,119 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file SenderCache.h
+ * @date 2018
+ *
+ * Process-wide cache of recovered transaction senders.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <eth-crypto/core/Address.h>
+#include <eth-crypto/crypto/Common.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * @brief Bounded cache mapping (r, s, v, signing hash) to the sender address.
+ * The same transaction is usually seen several times (gossip, pool, block), each time
+ * in a fresh TransactionBase; the cache lets all of them skip public key recovery.
+ * Entries are spread over independently locked shards, each evicting its least
+ * recently used entry once full.
+ */
+class SenderCache
+{
+public:
+	static size_t const c_defaultCapacity = 1 << 16;
+	static unsigned const c_defaultShards = 16;
+
+	/// @returns the process-wide cache used by TransactionBase::sender().
+	static SenderCache& instance();
+
+	/// Constructs a cache holding at most @a _capacity entries spread over @a _shards shards.
+	explicit SenderCache(size_t _capacity = c_defaultCapacity, unsigned _shards = c_defaultShards);
+
+	/// Looks up the sender of the signature @a _sig over @a _hash.
+	/// @returns true and sets @a o_sender on a hit, leaves @a o_sender untouched otherwise.
+	bool lookup(SignatureStruct const& _sig, h256 const& _hash, Address& o_sender);
+
+	/// Records @a _sender as the signer of @a _sig over @a _hash.
+	void insert(SignatureStruct const& _sig, h256 const& _hash, Address const& _sender);
+
+	/// Changes the total capacity, evicting entries as needed. Zero disables the cache.
+	void setCapacity(size_t _capacity);
+
+	/// @returns the maximal number of entries.
+	size_t capacity() const { return m_capacity; }
+
+	/// @returns the current number of entries.
+	size_t size() const;
+
+	/// Drops all entries. Counters are kept.
+	void clear();
+
+	/// @returns the number of successful lookups.
+	uint64_t hits() const { return m_hits; }
+
+	/// @returns the number of failed lookups.
+	uint64_t misses() const { return m_misses; }
+
+	/// Resets the hit and miss counters.
+	void resetCounters() { m_hits = 0; m_misses = 0; }
+
+private:
+	/// Signature and signing hash laid out back to back.
+	using Key = FixedHash<97>;
+
+	struct KeyHash
+	{
+		/// r is uniformly distributed, so a word of it is a good enough hash.
+		size_t operator()(Key const& _k) const { size_t ret; memcpy(&ret, _k.data(), sizeof(ret)); return ret; }
+	};
+
+	struct Shard
+	{
+		using Entries = std::list<std::pair<Key, Address>>;
+
+		mutable std::mutex x_entries;
+		Entries entries;	///< Most recently used first.
+		std::unordered_map<Key, Entries::iterator, KeyHash> index;
+		size_t capacity = 0;
+
+		void evictTo(size_t _size);
+	};
+
+	static Key makeKey(SignatureStruct const& _sig, h256 const& _hash);
+
+	Shard& shardFor(Key const& _k);
+
+	std::unique_ptr<Shard[]> m_shards;
+	unsigned m_shardCount;
+	std::atomic<size_t> m_capacity;
+	std::atomic<uint64_t> m_hits{0};
+	std::atomic<uint64_t> m_misses{0};
+};
+
+}
+}
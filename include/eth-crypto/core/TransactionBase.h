@@ -68,7 +68,7 @@ public:
 	void streamRLP(RLPStream& _s, IncludeSignature _sig = WithSignature, bool _forEip155hash = false) const;
 
 	/// @returns the RLP serialisation of this transaction.
-	bytes rlp(IncludeSignature _sig = WithSignature) const { RLPStream s; streamRLP(s, _sig); return s.out(); }
+	bytes rlp(IncludeSignature _sig = WithSignature) const { RLPStream s; streamRLP(s, _sig); bytes ret; s.swapOut(ret); return ret; }
 
 	/// @returns the SHA3 hash of the RLP serialisation of this transaction.
 	h256 sha3(IncludeSignature _sig = WithSignature) const;
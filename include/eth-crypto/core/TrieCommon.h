@@ -0,0 +1,39 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file TrieCommon.h
+ * @date 2018
+ *
+ * Definitions shared by the Merkle-Patricia trie code.
+ */
+
+#pragma once
+
+#include <eth-crypto/core/Common.h>
+#include <eth-crypto/core/FixedHash.h>
+#include <eth-crypto/core/Keccak.h>
+
+namespace dev
+{
+
+/// Root hash of a trie without entries, sha3(rlp("")).
+constexpr h256 EmptyTrie = constSha3("\x80", 1);
+
+/// Compact (hex-prefix) encoding of the nibble path @a _nibbles, as stored in leaf
+/// (@a _leaf true) and extension nodes.
+bytes hexPrefixEncode(bytesConstRef _nibbles, bool _leaf);
+
+}
@@ -0,0 +1,89 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file TrieHash.h
+ * @date 2018
+ *
+ * Roots of ordered tries, as used for transactionsRoot and receiptsRoot.
+ */
+
+#pragma once
+
+#include <vector>
+#include <eth-crypto/core/TrieCommon.h>
+
+namespace dev
+{
+
+/// @returns the root of the trie mapping rlp(i) to @a _items[i], e.g. a block's
+/// transactionsRoot given its RLP encoded transactions. Large tries are hashed on up to
+/// @a _threads threads, zero meaning one per hardware thread.
+h256 orderedTrieRoot(std::vector<bytesConstRef> const& _items, unsigned _threads = 0);
+
+/// Same as above.
+h256 orderedTrieRoot(std::vector<bytes> const& _items, unsigned _threads = 0);
+
+/**
+ * @brief Computes the root of an ordered trie while its items are appended one by one.
+ * Keys rlp(i) arrive in trie order except for item 0, which sorts after items 1 to 127
+ * and is held back until item 128 comes in. Since keys arrive sorted, a subtree is complete
+ * as soon as a key leaves it: it is hashed right then and only its reference is kept. What
+ * stays in memory is the branches on the path to the last item, that item, and item 0.
+ * Hashing is sequential; orderedTrieRoot() hashes large tries on several threads when all
+ * items are at hand.
+ */
+class OrderedTrieRoot
+{
+public:
+	/// Appends the item with the next index.
+	OrderedTrieRoot& append(bytesConstRef _item);
+
+	/// @returns the number of items appended.
+	size_t size() const { return m_size; }
+
+	/// @returns the root of the trie of all items appended so far. More items can be
+	/// appended afterwards.
+	h256 root() const;
+
+	/// Drops all items.
+	void clear();
+
+private:
+	/// A branch node on the path to the last item. Its children left of that path are
+	/// complete and held by reference: inline RLP, or the RLP of their hash.
+	struct Branch
+	{
+		unsigned depth;		///< Nibbles of key above the branch.
+		bytes children[16];
+	};
+
+	/// Adds the item with key rlp(@a _index), which sorts after all keys added so far.
+	void insert(size_t _index, bytesConstRef _value);
+
+	/// Completes the subtree holding the last item below nibble @a _start: hashes the
+	/// branches from depth @a _start down, drops them from m_path and @returns the RLP
+	/// of the subtree's top node.
+	bytes collapse(unsigned _start);
+
+	size_t m_size = 0;
+	bytes m_first;					///< Item 0, until it is inserted.
+	std::vector<Branch> m_path;		///< Branches on the path to the last item, root first.
+	byte m_lastKey[18];				///< Nibbles of the last item's key; rlp of a 64-bit index is at most 9 bytes.
+	unsigned m_lastKeySize = 0;		///< Zero if no item was inserted yet.
+	bytes m_lastValue;
+};
+
+}
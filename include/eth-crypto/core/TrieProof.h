@@ -0,0 +1,53 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file TrieProof.h
+ * @date 2018
+ *
+ * Verification of Merkle-Patricia proofs, as returned by eth_getProof.
+ */
+
+#pragma once
+
+#include <vector>
+#include <eth-crypto/core/TrieCommon.h>
+
+namespace dev
+{
+
+/// A Merkle-Patricia proof. Refers to the caller's data, which must outlive it.
+struct TrieProof
+{
+	bytesConstRef key;					///< Path in the trie, e.g. sha3(address) for an account.
+	std::vector<bytesConstRef> nodes;	///< The RLP nodes from the root down to the key.
+};
+
+/// Verifies @a _proof against the trie root @a _root and sets @a o_value to the value it
+/// proves for its key, pointing into the proof's nodes. @a o_value is left empty if the
+/// proof shows the key is absent.
+/// @returns false if the proof is invalid.
+bool verifyProof(h256 const& _root, TrieProof const& _proof, bytesConstRef& o_value);
+
+/// Verifies @a _proofs, all against the root @a _root, e.g. the storage proofs of an
+/// account. Nodes the proofs share are decoded and hashed once, all nodes are hashed
+/// together with sha3_ethash_batch(), and no node is copied. o_values[i] is the value
+/// proven by _proofs[i], empty if the key is absent or the proof invalid. A proof may
+/// draw on nodes given by another proof of the batch, which are hash-checked alike.
+/// @returns true if all proofs are valid; the indices of the invalid ones, in ascending
+/// order, go to @a o_failures if given.
+bool verifyProofs(h256 const& _root, std::vector<TrieProof> const& _proofs, std::vector<bytesConstRef>& o_values, std::vector<size_t>* o_failures = nullptr);
+
+}
@@ -0,0 +1,92 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file WorkerPool.h
+ * @date 2018
+ *
+ * Persistent worker threads for the batch APIs.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dev
+{
+
+/**
+ * @brief Threads kept alive between batches.
+ * Starting threads for every batch costs more than small batches take to process, and
+ * loses whatever the threads keep in thread_local storage (e.g. secp256k1 contexts).
+ * Threads are started on demand, as many as the largest batch so far asked for, and
+ * live until the pool is destroyed. Several callers may run batches at the same time.
+ */
+class WorkerPool
+{
+public:
+	using Task = std::function<void(size_t)>;
+
+	/// @returns the process-wide pool.
+	static WorkerPool& instance();
+
+	WorkerPool() = default;
+	~WorkerPool();
+
+	WorkerPool(WorkerPool const&) = delete;
+	WorkerPool& operator=(WorkerPool const&) = delete;
+
+	/// Runs @a _task(i) for every i in [0, @a _count), i = 0 on the calling thread and the
+	/// others on pool threads, and returns when all are done. The calling thread picks up
+	/// queued tasks while it waits, so a task may itself run a batch.
+	/// Rethrows the first exception a task threw.
+	void run(size_t _count, Task const& _task);
+
+	/// @returns the number of threads started so far.
+	size_t size() const;
+
+private:
+	struct Batch
+	{
+		Task const* task;
+		size_t pending;
+		std::exception_ptr error;
+	};
+
+	struct Job
+	{
+		Batch* batch;
+		size_t index;
+	};
+
+	void workLoop();
+
+	/// Runs @a _job and accounts for it in its batch. Must not hold x_queue.
+	void execute(Job const& _job);
+
+	mutable std::mutex x_queue;
+	std::condition_variable m_wake;		///< Signalled when jobs are queued or the pool stops.
+	std::condition_variable m_done;		///< Signalled when a batch completes.
+	std::deque<Job> m_queue;
+	std::vector<std::thread> m_threads;
+	bool m_stop = false;
+};
+
+}
@@ -11,23 +11,27 @@
 
 #include <openssl/evp.h>
 
-#include <../../eth-crypto/ethash/src/libethash/sha3.h>
-#include <../../eth-crypto/ethash/src/libethash/ethash.h>
-
 #include "FixedHash.h"
+#include "Keccak.h"
 
 namespace dev
 {
 
 namespace openssl {
 
+/// Incremental SHA-3 over an OpenSSL digest context.
+/// The context is created once; reset() starts a new hash on it, so one encoder can
+/// hash any number of messages without reallocating.
 template<size_t N>
 class sha3_encoder_base {
 public:
   template<typename T>
   sha3_encoder_base(T p_evp_sha_func)
-    :m_evp_sha_func(p_evp_sha_func) {
+    :m_md(p_evp_sha_func()) {
       ctx = EVP_MD_CTX_create();
+      if (!ctx || EVP_MD_size(m_md) != int(N))
+        throw std::runtime_error("sha3_encoder_base: cannot set up digest context");
+      reset();
   }
   
   using result_t = dev::FixedHash<N>;
@@ -35,6 +39,14 @@ public:
   virtual ~sha3_encoder_base() {
       EVP_MD_CTX_destroy(ctx);
   }
+
+  sha3_encoder_base(sha3_encoder_base const&) = delete;
+  sha3_encoder_base& operator=(sha3_encoder_base const&) = delete;
+
+  /// Discards the data written so far and starts a new hash.
+  void reset() {
+      EVP_DigestInit_ex(ctx, m_md, NULL);
+  }
   
   void write(const char *d, uint32_t dlen) {
       //TODO: implement error handling
@@ -45,13 +57,11 @@ public:
       write(&c, 1);
   }
   
+  /// @returns the hash of the data written since construction or the last reset().
+  /// Call reset() before writing the next message.
   result_t result() {
       result_t result;
       unsigned int digest_len;
-      int sha_size = EVP_MD_size(m_evp_sha_func());
-      if(result.size != sha_size)
-        throw std::runtime_error("sha3_encoder_base::result(): Invalid sha3_256 hash size");
-      
       EVP_DigestFinal_ex(ctx, result.data(), &digest_len);
     
       if(digest_len != result.size)
@@ -62,8 +72,7 @@ public:
   
   void result(char *out, uint32_t dlen) {
       unsigned int digest_len;
-      int sha_size = EVP_MD_size(m_evp_sha_func());
-      if(dlen != sha_size)
+      if(dlen != N)
         throw std::runtime_error("sha3_encoder_base::result(char, uint32_t): Invalid sha3_256 hash size");
       EVP_DigestFinal_ex(ctx, (unsigned char *) out, &digest_len);
       if(digest_len != dlen)
@@ -72,7 +81,7 @@ public:
 
 protected:
   EVP_MD_CTX *ctx;
-  std::function<const EVP_MD *(void)> m_evp_sha_func;
+  EVP_MD const* m_md;	///< Looked up once, the EVP_sha3_* getters are not free.
 };
 
 class sha3_224_encoder : public sha3_encoder_base<28> {
@@ -99,11 +108,13 @@ public:
 // SHA-3 convenience routines.
 
 /// Calculate SHA3-256 hash of the given input and load it into the given output.
+/// Runs on a digest context kept per thread, so only the hashing itself is paid per call.
 /// @returns false if o_output.size() != 32.
 bool sha3(bytesConstRef _input, bytesRef o_output) noexcept;
 
 /// Calculate SHA3-512 hash of the given input and load it into the given output.
-/// @returns false if o_output.size() != 32.
+/// Runs on a digest context kept per thread, like sha3().
+/// @returns false if o_output.size() != 64.
 bool sha3_512(bytesConstRef _input, bytesRef o_output) noexcept;
 
 inline h512 sha3_512(bytesConstRef _input) noexcept {
@@ -188,15 +199,29 @@ inline SecureFixedHash<32> sha3Secure(SecureFixedHash<N> const &_input) noexcept
 namespace ethash
 {
 
-h256 sha3_ethash(bytes const &_input);
+/// Calculate the Ethereum Keccak-256 hash of the given input.
+h256 sha3_ethash(bytesConstRef _input);
+
+inline h256 sha3_ethash(bytes const &_input) {
+    return sha3_ethash(bytesConstRef(&_input));
+}
+
+/// Hashes @a _count independent inputs: o_hashes[i] = sha3_ethash(_inputs[i]).
+/// Inputs are hashed several at a time, 8-way with AVX-512 or 4-way with AVX2
+/// when the host supports it, one at a time otherwise.
+void sha3_ethash_batch(bytesConstRef const* _inputs, h256* o_hashes, size_t _count);
+
+/// Same as above; @a o_hashes is resized to the number of inputs.
+inline void sha3_ethash_batch(std::vector<bytesConstRef> const& _inputs, h256s& o_hashes) {
+    o_hashes.resize(_inputs.size());
+    sha3_ethash_batch(_inputs.data(), o_hashes.data(), _inputs.size());
+}
 
+/// Same as sha3_ethash(_input.ref()); hashes shorter than a Keccak block (addresses,
+/// keys, public keys, node pairs) take a single unrolled permutation.
 template<unsigned N>
 h256 sha3_ethash(FixedHash<N> const &_input) {
-    auto res = ethash_h256_t();
-    SHA3_256(static_cast<const ethash_h256 *> (&res), _input.data(), N);
-    dev::FixedHash<32> hash((byte const *) &res.b[0],
-                            dev::FixedHash<32>::ConstructFromPointerType::ConstructFromPointer);
-    return hash;
+    return keccak::hashFixed<N>(_input.data());
 }
 
 };
@@ -25,6 +25,7 @@
 #pragma once
 
 #include <mutex>
+#include <boost/filesystem/path.hpp>
 #include <eth-crypto/core/Address.h>
 #include <eth-crypto/core/Common.h>
 #include <eth-crypto/core/Exceptions.h>
@@ -36,10 +37,38 @@
 namespace dev
 {
 
+/// Precomputation carried by a secp256k1 context.
+enum class ContextKind
+{
+	Sign,		///< Can create public keys and signatures.
+	Verify,		///< Can verify signatures and recover public keys.
+	Full		///< Both of the above.
+};
+
+/// @returns the calling thread's context of the given kind, created on first use.
+/// Each kind's precomputed tables are built once per process and copied into the
+/// per-thread contexts, so threads do not share a context and starting a thread
+/// does not regenerate tables. Sign contexts are randomized per thread for side-channel blinding.
+secp256k1_context const* getCtx(ContextKind _kind);
+
+/// @returns the calling thread's context for signing.
+inline secp256k1_context const* getSignCtx() { return getCtx(ContextKind::Sign); }
+
+/// @returns the calling thread's context for verification and recovery.
+inline secp256k1_context const* getVerifyCtx() { return getCtx(ContextKind::Verify); }
+
+/// @returns the calling thread's context able to both sign and verify.
 secp256k1_context const* getCtx();
 
+/// Builds the process-wide tables of the given kinds ahead of first use,
+/// e.g. on a background thread at startup. Tables are otherwise built on demand.
+void preloadCtx(bool _sign, bool _verify);
+
 using Secret = SecureFixedHash<32>;
 
+/// A Secret kept in locked memory; see LockedFixedHash.
+using LockedSecret = LockedFixedHash<32>;
+
 /// A public key: 64 bytes.
 /// @NOTE This is not endian-specific; it's just a bunch of bytes.
 using Public = h512;
@@ -66,6 +95,56 @@ struct SignatureStruct
 /// A vector of secrets.
 using Secrets = std::vector<Secret>;
 
+/// A vector of public keys.
+using Publics = h512s;
+
+/// A public key already parsed and validated into the secp256k1 internal representation.
+/// Keep one around for keys that are used repeatedly (e.g. per peer) so that parsing
+/// and curve validation are paid only once. This is the way to verify against pinned
+/// signers (validators, hot wallets, relayers): hold their ParsedPublics and pass them to
+/// verify() or verifyBatch(). libsecp256k1 offers no per-key precomputation beyond this.
+class ParsedPublic
+{
+public:
+	/// Constructs a null key.
+	ParsedPublic() = default;
+
+	/// Parses @a _p. The result is null if @a _p is not a point on the curve.
+	explicit ParsedPublic(Public const& _p);
+
+	/// @returns true if the key was parsed successfully.
+	explicit operator bool() const { return m_valid; }
+
+	/// @returns the serialized key this was parsed from.
+	Public const& pub() const { return m_public; }
+
+	/// @returns the secp256k1 internal representation. Only meaningful if the key is valid.
+	secp256k1_pubkey const& raw() const { return m_raw; }
+
+private:
+	Public m_public;
+	secp256k1_pubkey m_raw;
+	bool m_valid = false;
+};
+
+/// A vector of parsed public keys.
+using ParsedPublics = std::vector<ParsedPublic>;
+
+/// A vector of signatures.
+using Signatures = std::vector<Signature>;
+
+/// Outcome of a single public key recovery.
+enum class RecoverResult: uint8_t
+{
+	Ok = 0,
+	InvalidRecoveryId,	///< v is not in the [0, 3] range.
+	InvalidSignature,	///< r and s do not form a valid compact signature.
+	NoPublicKey			///< No public key matches the signature and hash.
+};
+
+/// A vector of recovery outcomes, one per signature of a batch.
+using RecoverResults = std::vector<RecoverResult>;
+
 /// Convert a secret key into the public key equivalent.
 Public toPublic(Secret const& _secret);
 
@@ -125,13 +204,69 @@ Address toAddress(Address const& _from, u256 const& _nonce);
 
 /// Recovers Public key from signed message hash.
 Public recover(Signature const& _sig, h256 const& _hash);
+
+/// Recovers Public keys from a batch of signed message hashes.
+/// @a o_publics and @a o_results are resized to the batch size and written in place:
+/// item i holds a valid key iff o_results[i] == RecoverResult::Ok.
+/// The batch is split across @a _threads workers (0 means one per hardware thread),
+/// each of them using its own secp256k1 context.
+/// @returns the number of signatures that could not be recovered.
+/// @throws std::invalid_argument if @a _sigs and @a _hashes differ in size.
+size_t recoverBatch(Signatures const& _sigs, h256s const& _hashes, Publics& o_publics, RecoverResults& o_results, unsigned _threads = 0);
 	
 /// Returns siganture of message hash.
 Signature sign(Secret const& _k, h256 const& _hash);
 
 /// Verify signature.
+/// Runs a plain ECDSA verification against @a _k without recovering a point;
+/// the recovery id of @a _s is only checked to be in range.
 bool verify(Public const& _k, Signature const& _s, h256 const& _hash);
 
+/// Verify signature against an already parsed public key.
+bool verify(ParsedPublic const& _k, Signature const& _s, h256 const& _hash);
+
+/// Verify that @a _s over @a _hash was produced by the owner of address @a _a.
+bool verify(Address const& _a, Signature const& _s, h256 const& _hash);
+
+/// Verifies a batch of signatures, item i being @a _sigs[i] over @a _hashes[i] by @a _publics[i].
+/// This is not batch verification in the cryptographic sense: every item is a separate
+/// verify() call, so a batch costs the same per signature and is faster only by running
+/// on several threads.
+/// With @a o_failures null the answer is all-or-nothing and the workers stop at the first
+/// bad item; otherwise every item is checked and @a o_failures receives the indices of the
+/// bad ones in ascending order.
+/// The batch is split across @a _threads workers (0 means one per hardware thread).
+/// @returns true iff every signature is valid.
+/// @throws std::invalid_argument if the argument sizes differ.
+bool verifyBatch(Signatures const& _sigs, h256s const& _hashes, Publics const& _publics, std::vector<size_t>* o_failures = nullptr, unsigned _threads = 0);
+
+/// Same as above, against keys the caller keeps parsed, e.g. those of pinned signers.
+bool verifyBatch(Signatures const& _sigs, h256s const& _hashes, ParsedPublics const& _publics, std::vector<size_t>* o_failures = nullptr, unsigned _threads = 0);
+
+/// Same as above, checking that each signature was produced by the owner of @a _addresses[i].
+bool verifyBatch(Signatures const& _sigs, h256s const& _hashes, Addresses const& _addresses, std::vector<size_t>* o_failures = nullptr, unsigned _threads = 0);
+
+/// Throughput of a bulk key generation run.
+struct KeyGenStats
+{
+	size_t keys = 0;
+	double seconds = 0;
+
+	double keysPerSecond() const { return seconds > 0 ? keys / seconds : 0; }
+};
+
+/// Derives the addresses of @a _count consecutive secret keys @a _first, @a _first + 1, ...
+/// into @a o_addresses, which is resized to @a _count.
+/// Each worker runs one scalar multiplication for its first key and a single point
+/// addition for every following one, and hashes the keys with sha3_ethash_batch().
+/// The batch is split across @a _threads workers (0 means one per hardware thread).
+/// @throws std::invalid_argument if any of the secrets is not a valid key.
+KeyGenStats generateAddresses(Secret const& _first, size_t _count, Addresses& o_addresses, unsigned _threads = 0);
+
+/// Same as above, writing the addresses as consecutive raw 20-byte records to @a _file.
+/// @throws std::runtime_error if the file cannot be written.
+KeyGenStats generateAddresses(Secret const& _first, size_t _count, boost::filesystem::path const& _file, unsigned _threads = 0);
+
 /// Derive key via PBKDF2.
 //bytesSec pbkdf2(std::string const& _pass, bytes const& _salt, unsigned _iterations, unsigned _dkLen = 32);
 
@@ -201,7 +336,7 @@ private:
 	/// @returns the next nonce.
 	Secret next();
 
-//	std::mutex x_value;
+	std::mutex x_value;
 	Secret m_value;
 };
 
@@ -210,6 +345,9 @@ namespace ecdh
 
 bool agree(Secret const& _s, Public const& _r, Secret& o_s) noexcept;
 
+/// Same as above, skipping the parsing and validation of the remote public key.
+bool agree(Secret const& _s, ParsedPublic const& _r, Secret& o_s) noexcept;
+
 }
 
 namespace ecies
@@ -0,0 +1,358 @@
+/*
+ * Keccak.cpp
+ *
+ *  (c) 2018 array.io
+ *
+ * Keccak-256 as used by Ethereum: incremental and for batches of independent inputs.
+ */
+
+#include <eth-crypto/core/Keccak.h>
+#include <eth-crypto/core/sha3_wrap.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include "KeccakF1600.h"
+
+using namespace std;
+using namespace dev;
+using namespace dev::keccak;
+
+// Catch a broken compile-time Keccak at build time: Keccak-256("") and a known selector.
+static_assert(keccak::constant::hash("", 0).bytes[0] == 0xc5 && keccak::constant::hash("", 0).bytes[31] == 0x70, "constSha3 is broken");
+static_assert(keccak::constant::hash("transfer(address,uint256)", 25).bytes[0] == 0xa9 && keccak::constant::hash("transfer(address,uint256)", 25).bytes[3] == 0xbb, "constSelector is broken");
+
+namespace
+{
+
+using PermuteN = void (*)(uint64_t*);
+
+/// A Keccak-f[1600] implementation for a given instruction set.
+struct Backend
+{
+	char const* name;
+	bool (*supported)();
+	PermuteN permute;	///< Single state, null for the SIMD backends that only do batches.
+	unsigned lanes;		///< Number of interleaved states permuteN works on.
+	PermuteN permuteN;
+};
+
+bool alwaysSupported()
+{
+	return true;
+}
+
+/// All backends, from the most portable to the most demanding.
+Backend const c_backends[] = {
+	{"scalar", &alwaysSupported, &permuteScalar, 1, &permuteScalar},
+	{"scalar-bmi2", &hasBMI2, &permuteBMI2, 1, &permuteBMI2},
+	{"avx2", &hasAVX2, nullptr, 4, &permuteX4AVX2},
+	{"avx512", &hasAVX512, nullptr, 8, &permuteX8AVX512}
+};
+
+/// Environment variable naming the backend to use, or "bench" to time them all at startup.
+char const* const c_backendEnv = "ETH_CRYPTO_KECCAK";
+
+/**
+ * @brief Backends in use, one for single inputs and one for batches.
+ * Chosen from CPUID on first use: single inputs take the scalar-bmi2 build when the host has
+ * BMI2, since andn and rorx shorten each round by a measurable margin over plain scalar code,
+ * and batches take the widest multi-buffer kernel. c_backendEnv can override this.
+ */
+class Registry
+{
+public:
+	static Registry& instance()
+	{
+		static Registry s_registry;
+		return s_registry;
+	}
+
+	Backend const& single() const { return *m_single.load(std::memory_order_relaxed); }
+	Backend const& batch() const { return *m_batch.load(std::memory_order_relaxed); }
+
+	bool select(std::string const& _name)
+	{
+		for (auto const& b: c_backends)
+			if (_name == b.name && b.supported())
+			{
+				if (b.permute)
+					m_single = &b;
+				m_batch = &b;
+				return true;
+			}
+		return false;
+	}
+
+	void benchmark()
+	{
+		unsigned const c_rounds = 2000;
+		double bestSingle = 0;
+		double bestBatch = 0;
+		for (auto const& b: c_backends)
+		{
+			if (!b.supported())
+				continue;
+			if (b.permute)
+			{
+				double const single = timePerState(b.permute, 1, c_rounds);
+				if (!bestSingle || single < bestSingle)
+				{
+					bestSingle = single;
+					m_single = &b;
+				}
+			}
+			double const batch = timePerState(b.permuteN, b.lanes, c_rounds / b.lanes);
+			if (!bestBatch || batch < bestBatch)
+			{
+				bestBatch = batch;
+				m_batch = &b;
+			}
+		}
+	}
+
+private:
+	Registry(): m_single(&c_backends[0]), m_batch(&c_backends[0])
+	{
+		for (auto const& b: c_backends)
+			if (b.supported())
+			{
+				if (b.permute)
+					m_single = &b;
+				m_batch = &b;
+			}
+
+		if (char const* env = getenv(c_backendEnv))
+		{
+			if (std::string(env) == "bench")
+				benchmark();
+			else
+				select(env);
+		}
+	}
+
+	/// @returns the time in seconds one state takes with @a _permute.
+	static double timePerState(PermuteN _permute, unsigned _lanes, unsigned _rounds)
+	{
+		std::vector<uint64_t> states(c_stateWords * _lanes, 0);
+		_permute(states.data());	// Warm up.
+		auto const start = std::chrono::steady_clock::now();
+		for (unsigned i = 0; i < _rounds; ++i)
+			_permute(states.data());
+		std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / (double(_rounds) * _lanes);
+	}
+
+	std::atomic<Backend const*> m_single;
+	std::atomic<Backend const*> m_batch;
+};
+
+inline uint64_t loadLE64(byte const* _p)
+{
+	uint64_t ret = 0;
+	for (unsigned i = 0; i < 8; ++i)
+		ret |= uint64_t(_p[i]) << (8 * i);
+	return ret;
+}
+
+/// XORs the next block of @a _in, starting at @a _offset, into word-interleaved state @a _lane
+/// of @a io_states. The final block gets the Keccak padding.
+/// @returns true if this was the final block.
+template <size_t L>
+bool absorbBlock(uint64_t* io_states, size_t _lane, bytesConstRef _in, size_t _offset)
+{
+	byte const* p = _in.data() + _offset;
+	size_t const left = _in.size() - _offset;
+	if (left >= c_rate256)
+	{
+		for (size_t w = 0; w < c_rate256 / 8; ++w)
+			io_states[w * L + _lane] ^= loadLE64(p + 8 * w);
+		return false;
+	}
+
+	byte block[c_rate256] = {};
+	if (left)
+		memcpy(block, p, left);
+	block[left] ^= 0x01;
+	block[c_rate256 - 1] ^= 0x80;
+	for (size_t w = 0; w < c_rate256 / 8; ++w)
+		io_states[w * L + _lane] ^= loadLE64(block + 8 * w);
+	return true;
+}
+
+/// Hashes @a _count inputs on @a L interleaved states permuted together by @a _permute.
+/// A lane whose input is done is refilled with the next input right away, so inputs of
+/// different lengths do not leave lanes idle until the longest one is done.
+template <size_t L>
+void hashBatch(bytesConstRef const* _in, h256* o_out, size_t _count, PermuteN _permute)
+{
+	size_t const c_idle = size_t(-1);
+	uint64_t states[c_stateWords * L];
+	size_t item[L];
+	size_t offset[L];
+	bool last[L];
+	std::fill(item, item + L, c_idle);
+
+	size_t next = 0;
+	while (true)
+	{
+		bool active = false;
+		for (size_t l = 0; l < L; ++l)
+		{
+			if (item[l] == c_idle && next < _count)
+			{
+				item[l] = next++;
+				offset[l] = 0;
+				for (size_t w = 0; w < c_stateWords; ++w)
+					states[w * L + l] = 0;
+			}
+			if (item[l] != c_idle)
+			{
+				active = true;
+				last[l] = absorbBlock<L>(states, l, _in[item[l]], offset[l]);
+				offset[l] += c_rate256;
+			}
+		}
+		if (!active)
+			return;
+
+		_permute(states);
+
+		for (size_t l = 0; l < L; ++l)
+			if (item[l] != c_idle && last[l])
+			{
+				byte* out = o_out[item[l]].data();
+				for (size_t w = 0; w < 4; ++w)
+					for (unsigned i = 0; i < 8; ++i)
+						out[8 * w + i] = byte(states[w * L + l] >> (8 * i));
+				item[l] = c_idle;
+			}
+	}
+}
+
+}
+
+void dev::keccak::permuteScalar(uint64_t* io_state)
+{
+	keccakF1600<ScalarOps>(io_state);
+}
+
+void dev::keccak::permute(uint64_t* io_state)
+{
+	Registry::instance().single().permute(io_state);
+}
+
+std::vector<std::string> dev::keccak::availableBackends()
+{
+	std::vector<std::string> ret;
+	for (auto const& b: c_backends)
+		if (b.supported())
+			ret.push_back(b.name);
+	return ret;
+}
+
+std::string dev::keccak::activeBackend()
+{
+	return Registry::instance().single().name;
+}
+
+std::string dev::keccak::activeBatchBackend()
+{
+	return Registry::instance().batch().name;
+}
+
+bool dev::keccak::selectBackend(std::string const& _name)
+{
+	return Registry::instance().select(_name);
+}
+
+void dev::keccak::benchmarkBackends()
+{
+	Registry::instance().benchmark();
+}
+
+h256 dev::keccak::squeezeBlock(uint64_t* io_state)
+{
+	permute(io_state);
+	h256 ret;
+	for (size_t w = 0; w < 4; ++w)
+		for (unsigned i = 0; i < 8; ++i)
+			ret[8 * w + i] = byte(io_state[w] >> (8 * i));
+	return ret;
+}
+
+void Keccak256::reset()
+{
+	std::fill(m_state, m_state + c_stateWords, 0);
+	m_buffered = 0;
+}
+
+Keccak256& Keccak256::update(bytesConstRef _data)
+{
+	byte const* p = _data.data();
+	size_t left = _data.size();
+
+	if (m_buffered)
+	{
+		size_t const n = std::min(left, c_rate - m_buffered);
+		memcpy(m_buffer + m_buffered, p, n);
+		m_buffered += n;
+		p += n;
+		left -= n;
+		if (m_buffered < c_rate)
+			return *this;
+		for (size_t w = 0; w < c_rate / 8; ++w)
+			m_state[w] ^= loadLE64(m_buffer + 8 * w);
+		permute(m_state);
+		m_buffered = 0;
+	}
+
+	// Full blocks are absorbed straight from the input.
+	for (; left >= c_rate; p += c_rate, left -= c_rate)
+	{
+		for (size_t w = 0; w < c_rate / 8; ++w)
+			m_state[w] ^= loadLE64(p + 8 * w);
+		permute(m_state);
+	}
+
+	if (left)
+		memcpy(m_buffer, p, left);
+	m_buffered = left;
+	return *this;
+}
+
+h256 Keccak256::final()
+{
+	memset(m_buffer + m_buffered, 0, c_rate - m_buffered);
+	m_buffer[m_buffered] ^= 0x01;
+	m_buffer[c_rate - 1] ^= 0x80;
+	for (size_t w = 0; w < c_rate / 8; ++w)
+		m_state[w] ^= loadLE64(m_buffer + 8 * w);
+	permute(m_state);
+
+	h256 ret;
+	for (size_t w = 0; w < 4; ++w)
+		for (unsigned i = 0; i < 8; ++i)
+			ret[8 * w + i] = byte(m_state[w] >> (8 * i));
+	reset();
+	return ret;
+}
+
+void dev::ethash::sha3_ethash_batch(bytesConstRef const* _inputs, h256* o_hashes, size_t _count)
+{
+	Registry const& registry = Registry::instance();
+	Backend const& b = registry.batch();
+
+	// A wide kernel only pays off once there are enough inputs to fill its lanes.
+	if (b.lanes == 8 && _count > 4)
+		hashBatch<8>(_inputs, o_hashes, _count, b.permuteN);
+	else if (b.lanes == 4 && _count > 1)
+		hashBatch<4>(_inputs, o_hashes, _count, b.permuteN);
+	else
+		hashBatch<1>(_inputs, o_hashes, _count, registry.single().permute);
+}
+
+h256 dev::ethash::sha3_ethash(bytesConstRef _input)
+{
+	return Keccak256().update(_input).final();
+}
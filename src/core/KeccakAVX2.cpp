@@ -0,0 +1,70 @@
+/*
+ * KeccakAVX2.cpp
+ *
+ *  (c) 2018 array.io
+ *
+ * 4-way Keccak-f[1600] on AVX2. Built with AVX2 code generation enabled, see CMakeLists.txt;
+ * only called after the host was checked for AVX2 support.
+ */
+
+#include "KeccakF1600.h"
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+
+struct AVX2Ops
+{
+	using V = __m256i;
+	static V bxor(V _a, V _b) { return _mm256_xor_si256(_a, _b); }
+	static V chi(V _a, V _b, V _c) { return _mm256_xor_si256(_a, _mm256_andnot_si256(_b, _c)); }
+	template <int N> static V rotl(V _x) { return _mm256_or_si256(_mm256_slli_epi64(_x, N), _mm256_srli_epi64(_x, 64 - N)); }
+	static V constant(uint64_t _c) { return _mm256_set1_epi64x(static_cast<long long>(_c)); }
+};
+
+}
+
+void dev::keccak::permuteX4AVX2(uint64_t* io_states)
+{
+	__m256i a[c_stateWords];
+	for (size_t i = 0; i < c_stateWords; ++i)
+		a[i] = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(io_states + 4 * i));
+	keccakF1600<AVX2Ops>(a);
+	for (size_t i = 0; i < c_stateWords; ++i)
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(io_states + 4 * i), a[i]);
+}
+
+bool dev::keccak::hasAVX2()
+{
+#if defined(_MSC_VER)
+	int r[4];
+	__cpuid(r, 1);
+	// The OS must save the extended registers on context switches.
+	if (!(r[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6)
+		return false;
+	__cpuidex(r, 7, 0);
+	return (r[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#else
+
+// Built without AVX2 support (e.g. non-x86 targets); never selected at runtime.
+bool dev::keccak::hasAVX2()
+{
+	return false;
+}
+
+void dev::keccak::permuteX4AVX2(uint64_t*)
+{
+}
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * KeccakAVX512.cpp
+ *
+ *  (c) 2018 array.io
+ *
+ * 8-way Keccak-f[1600] on AVX-512F. Built with AVX-512 code generation enabled, see CMakeLists.txt;
+ * only called after the host was checked for AVX-512F support.
+ */
+
+#include "KeccakF1600.h"
+
+#if defined(__AVX512F__)
+
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+
+struct AVX512Ops
+{
+	using V = __m512i;
+	static V bxor(V _a, V _b) { return _mm512_xor_si512(_a, _b); }
+	/// 0xd2 is the truth table of a ^ (~b & c).
+	static V chi(V _a, V _b, V _c) { return _mm512_ternarylogic_epi64(_a, _b, _c, 0xd2); }
+	template <int N> static V rotl(V _x) { return _mm512_rol_epi64(_x, N); }
+	static V constant(uint64_t _c) { return _mm512_set1_epi64(static_cast<long long>(_c)); }
+};
+
+}
+
+void dev::keccak::permuteX8AVX512(uint64_t* io_states)
+{
+	__m512i a[c_stateWords];
+	for (size_t i = 0; i < c_stateWords; ++i)
+		a[i] = _mm512_loadu_si512(io_states + 8 * i);
+	keccakF1600<AVX512Ops>(a);
+	for (size_t i = 0; i < c_stateWords; ++i)
+		_mm512_storeu_si512(io_states + 8 * i, a[i]);
+}
+
+bool dev::keccak::hasAVX512()
+{
+#if defined(_MSC_VER)
+	int r[4];
+	__cpuid(r, 1);
+	// The OS must save the extended registers on context switches.
+	if (!(r[2] & (1 << 27)) || (_xgetbv(0) & 0xe6) != 0xe6)
+		return false;
+	__cpuidex(r, 7, 0);
+	return (r[1] & (1 << 16)) != 0;
+#else
+	return __builtin_cpu_supports("avx512f");
+#endif
+}
+
+#else
+
+// Built without AVX-512 support (e.g. non-x86 targets); never selected at runtime.
+bool dev::keccak::hasAVX512()
+{
+	return false;
+}
+
+void dev::keccak::permuteX8AVX512(uint64_t*)
+{
+}
+
+#endif
@@ -0,0 +1,36 @@
+/*
+ * KeccakBMI2.cpp
+ *
+ *  (c) 2018 array.io
+ *
+ * Scalar Keccak-f[1600] built with BMI1/BMI2 code generation enabled (andn, rorx), see
+ * CMakeLists.txt; only called after the host was checked for BMI1 and BMI2 support.
+ */
+
+#include "KeccakF1600.h"
+
+#if defined(__BMI2__) && defined(__BMI__)
+
+bool dev::keccak::hasBMI2()
+{
+	return __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2");
+}
+
+void dev::keccak::permuteBMI2(uint64_t* io_state)
+{
+	keccakF1600<ScalarOps>(io_state);
+}
+
+#else
+
+// Built without BMI2 code generation (e.g. MSVC or non-x86 targets); never selected at runtime.
+bool dev::keccak::hasBMI2()
+{
+	return false;
+}
+
+void dev::keccak::permuteBMI2(uint64_t*)
+{
+}
+
+#endif
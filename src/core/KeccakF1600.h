@@ -0,0 +1,155 @@
+/*
+ * KeccakF1600.h
+ *
+ *  (c) 2018 array.io
+ *
+ * Keccak-f[1600] rounds shared by the scalar and SIMD backends.
+ * Private to the library: every translation unit including it gets its own copy,
+ * compiled with that unit's instruction set flags.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace dev
+{
+namespace keccak
+{
+
+/// Number of 64-bit words of a Keccak-f[1600] state.
+size_t const c_stateWords = 25;
+
+/// Rate of Keccak-256 in bytes.
+size_t const c_rate256 = 136;
+
+/// Applies Keccak-f[1600] to a single state with the active backend.
+void permute(uint64_t* io_state);
+
+// Backend kernels. The single-state ones run the same rounds, each compiled for the
+// instruction set of its backend; the SIMD ones permute several interleaved states
+// (state i, word w at [w * lanes + i]) and have no single-state variant, since one state
+// gains nothing from vector registers. Each hasX() tells whether the library was built
+// with backend X and the host can run it.
+
+void permuteScalar(uint64_t* io_state);
+
+bool hasBMI2();
+void permuteBMI2(uint64_t* io_state);
+
+bool hasAVX2();
+void permuteX4AVX2(uint64_t* io_states);
+
+bool hasAVX512();
+void permuteX8AVX512(uint64_t* io_states);
+
+namespace
+{
+
+uint64_t const c_roundConstants[24] = {
+	0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
+	0x000000000000808bULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+	0x000000000000008aULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+	0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+	0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800aULL, 0x800000008000000aULL,
+	0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+};
+
+/// Word operations on plain 64-bit integers.
+struct ScalarOps
+{
+	using V = uint64_t;
+	static V bxor(V _a, V _b) { return _a ^ _b; }
+	/// @returns _a ^ (~_b & _c), the chi step.
+	static V chi(V _a, V _b, V _c) { return _a ^ (~_b & _c); }
+	template <int N> static V rotl(V _x) { return (_x << N) | (_x >> (64 - N)); }
+	static V constant(uint64_t _c) { return _c; }
+};
+
+/// XORs @a _d into the column x of state @a a.
+template <class O>
+inline void thetaColumn(typename O::V* a, unsigned _x, typename O::V _d)
+{
+	a[_x] = O::bxor(a[_x], _d);
+	a[_x + 5] = O::bxor(a[_x + 5], _d);
+	a[_x + 10] = O::bxor(a[_x + 10], _d);
+	a[_x + 15] = O::bxor(a[_x + 15], _d);
+	a[_x + 20] = O::bxor(a[_x + 20], _d);
+}
+
+/// Applies chi to the row starting at word @a _y of @a b, writing it to @a a.
+template <class O>
+inline void chiRow(typename O::V* a, typename O::V const* b, unsigned _y)
+{
+	a[_y] = O::chi(b[_y], b[_y + 1], b[_y + 2]);
+	a[_y + 1] = O::chi(b[_y + 1], b[_y + 2], b[_y + 3]);
+	a[_y + 2] = O::chi(b[_y + 2], b[_y + 3], b[_y + 4]);
+	a[_y + 3] = O::chi(b[_y + 3], b[_y + 4], b[_y]);
+	a[_y + 4] = O::chi(b[_y + 4], b[_y], b[_y + 1]);
+}
+
+/// Applies the 24 rounds of Keccak-f[1600] to @a a, a state of 25 words of type O::V.
+/// With vector word types this permutes as many independent states as there are lanes.
+/// Steps are spelled out since compilers do not reliably unroll them at -O2.
+template <class O>
+inline void keccakF1600(typename O::V* a)
+{
+	using V = typename O::V;
+	V b[25];
+	for (unsigned round = 0; round < 24; ++round)
+	{
+		// Theta.
+		V const c0 = O::bxor(O::bxor(O::bxor(a[0], a[5]), O::bxor(a[10], a[15])), a[20]);
+		V const c1 = O::bxor(O::bxor(O::bxor(a[1], a[6]), O::bxor(a[11], a[16])), a[21]);
+		V const c2 = O::bxor(O::bxor(O::bxor(a[2], a[7]), O::bxor(a[12], a[17])), a[22]);
+		V const c3 = O::bxor(O::bxor(O::bxor(a[3], a[8]), O::bxor(a[13], a[18])), a[23]);
+		V const c4 = O::bxor(O::bxor(O::bxor(a[4], a[9]), O::bxor(a[14], a[19])), a[24]);
+		thetaColumn<O>(a, 0, O::bxor(c4, O::template rotl<1>(c1)));
+		thetaColumn<O>(a, 1, O::bxor(c0, O::template rotl<1>(c2)));
+		thetaColumn<O>(a, 2, O::bxor(c1, O::template rotl<1>(c3)));
+		thetaColumn<O>(a, 3, O::bxor(c2, O::template rotl<1>(c4)));
+		thetaColumn<O>(a, 4, O::bxor(c3, O::template rotl<1>(c0)));
+
+		// Rho and pi.
+		b[0] = a[0];
+		b[1] = O::template rotl<44>(a[6]);
+		b[2] = O::template rotl<43>(a[12]);
+		b[3] = O::template rotl<21>(a[18]);
+		b[4] = O::template rotl<14>(a[24]);
+		b[5] = O::template rotl<28>(a[3]);
+		b[6] = O::template rotl<20>(a[9]);
+		b[7] = O::template rotl<3>(a[10]);
+		b[8] = O::template rotl<45>(a[16]);
+		b[9] = O::template rotl<61>(a[22]);
+		b[10] = O::template rotl<1>(a[1]);
+		b[11] = O::template rotl<6>(a[7]);
+		b[12] = O::template rotl<25>(a[13]);
+		b[13] = O::template rotl<8>(a[19]);
+		b[14] = O::template rotl<18>(a[20]);
+		b[15] = O::template rotl<27>(a[4]);
+		b[16] = O::template rotl<36>(a[5]);
+		b[17] = O::template rotl<10>(a[11]);
+		b[18] = O::template rotl<15>(a[17]);
+		b[19] = O::template rotl<56>(a[23]);
+		b[20] = O::template rotl<62>(a[2]);
+		b[21] = O::template rotl<55>(a[8]);
+		b[22] = O::template rotl<39>(a[14]);
+		b[23] = O::template rotl<41>(a[15]);
+		b[24] = O::template rotl<2>(a[21]);
+
+		// Chi.
+		chiRow<O>(a, b, 0);
+		chiRow<O>(a, b, 5);
+		chiRow<O>(a, b, 10);
+		chiRow<O>(a, b, 15);
+		chiRow<O>(a, b, 20);
+
+		// Iota.
+		a[0] = O::bxor(a[0], O::constant(c_roundConstants[round]));
+	}
+}
+
+}
+
+}
+}
@@ -0,0 +1,212 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file LogBloom.cpp
+ * @date 2018
+ */
+
+#include <eth-crypto/core/LogBloom.h>
+#include <eth-crypto/core/sha3_wrap.h>
+#include <algorithm>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace std;
+using namespace dev;
+
+namespace
+{
+
+unsigned const c_bloomBits = 2048;
+unsigned const c_bloomWords = c_bloomBits / 64;
+
+/// Blocks handled per word of a row.
+unsigned const c_wordBlocks = 64;
+
+/// @returns the index of the lowest bit set in @a _x, which must not be zero.
+inline unsigned lowestBit(uint64_t _x)
+{
+#if defined(_MSC_VER)
+	unsigned long ret;
+	_BitScanForward64(&ret, _x);
+	return ret;
+#else
+	return __builtin_ctzll(_x);
+#endif
+}
+
+}
+
+BloomBits dev::bloomBitsOfHash(h256 const& _hash)
+{
+	BloomBits ret;
+	for (unsigned i = 0; i < 3; ++i)
+		ret[i] = ((_hash[2 * i] << 8) | _hash[2 * i + 1]) & (c_bloomBits - 1);
+	return ret;
+}
+
+BloomBits dev::bloomBits(bytesConstRef _entry)
+{
+	return bloomBitsOfHash(ethash::sha3_ethash(_entry));
+}
+
+void dev::setBloomBits(LogBloom& io_bloom, BloomBits const& _bits)
+{
+	for (auto b: _bits)
+		io_bloom[LogBloom::size - 1 - b / 8] |= byte(1 << (b % 8));
+}
+
+bool dev::hasBloomBits(LogBloom const& _bloom, BloomBits const& _bits)
+{
+	for (auto b: _bits)
+		if (!(_bloom[LogBloom::size - 1 - b / 8] & (1 << (b % 8))))
+			return false;
+	return true;
+}
+
+void dev::orBloom(LogBloom& io_bloom, LogBloom const& _bloom)
+{
+	// The words are not aligned, memcpy lets the compiler use plain (vector) loads anyway.
+	uint64_t a[c_bloomWords];
+	uint64_t b[c_bloomWords];
+	memcpy(a, io_bloom.data(), sizeof(a));
+	memcpy(b, _bloom.data(), sizeof(b));
+	for (unsigned i = 0; i < c_bloomWords; ++i)
+		a[i] |= b[i];
+	memcpy(io_bloom.data(), a, sizeof(a));
+}
+
+LogBloom const& LogBloomBuilder::bloom()
+{
+	std::vector<bytesConstRef> entries;
+	entries.reserve(m_addresses.size() + m_topics.size());
+	for (auto const& a: m_addresses)
+		entries.push_back(a.ref());
+	for (auto const& t: m_topics)
+		entries.push_back(t.ref());
+
+	h256s hashes;
+	ethash::sha3_ethash_batch(entries, hashes);
+	for (auto const& h: hashes)
+		setBloomBits(m_bloom, bloomBitsOfHash(h));
+
+	m_addresses.clear();
+	m_topics.clear();
+	return m_bloom;
+}
+
+void LogBloomBuilder::clear()
+{
+	m_addresses.clear();
+	m_topics.clear();
+	m_bloom.clear();
+}
+
+bool dev::bloomMatches(LogBloom const& _bloom, BloomFilter const& _filter)
+{
+	for (auto const& group: _filter)
+		if (!group.empty() && std::none_of(group.begin(), group.end(), [&](BloomBits const& _b) { return hasBloomBits(_bloom, _b); }))
+			return false;
+	return true;
+}
+
+BloomIndex::BloomIndex(uint64_t _firstBlock, unsigned _sectionSize):
+	m_sectionWords(std::max(1u, (_sectionSize + c_wordBlocks - 1) / c_wordBlocks)),
+	m_firstBlock(_firstBlock)
+{
+}
+
+void BloomIndex::append(LogBloom const& _bloom)
+{
+	uint64_t const sectionBlocks = uint64_t(m_sectionWords) * c_wordBlocks;
+	uint64_t const inSection = m_size % sectionBlocks;
+	if (!inSection)
+		m_rows.resize(m_rows.size() + size_t(c_bloomBits) * m_sectionWords, 0);
+
+	uint64_t* rows = m_rows.data() + (m_size / sectionBlocks) * c_bloomBits * m_sectionWords;
+	uint64_t const word = inSection / c_wordBlocks;
+	uint64_t const mask = uint64_t(1) << (inSection % c_wordBlocks);
+	for (unsigned i = 0; i < LogBloom::size; ++i)
+		if (byte b = _bloom[LogBloom::size - 1 - i])
+			for (unsigned j = 0; j < 8; ++j)
+				if (b & (1 << j))
+					rows[(i * 8 + j) * m_sectionWords + word] |= mask;
+	++m_size;
+}
+
+std::vector<uint64_t> BloomIndex::matches(BloomFilter const& _filter, uint64_t _from, uint64_t _to) const
+{
+	std::vector<uint64_t> ret;
+	if (!m_size || _to < m_firstBlock || _from > _to)
+		return ret;
+	uint64_t const from = std::max(_from, m_firstBlock) - m_firstBlock;
+	uint64_t const to = std::min(_to - m_firstBlock, m_size - 1);
+	if (from > to)
+		return ret;
+
+	uint64_t const sectionBlocks = uint64_t(m_sectionWords) * c_wordBlocks;
+	std::vector<uint64_t> result(m_sectionWords);
+	std::vector<uint64_t> group(m_sectionWords);
+	for (uint64_t section = from / sectionBlocks; section <= to / sectionBlocks; ++section)
+	{
+		uint64_t const base = section * sectionBlocks;
+		uint64_t const* rows = m_rows.data() + section * c_bloomBits * m_sectionWords;
+
+		// Start from the blocks of the range within this section.
+		for (unsigned w = 0; w < m_sectionWords; ++w)
+		{
+			uint64_t const first = base + uint64_t(w) * c_wordBlocks;
+			uint64_t bits = ~uint64_t(0);
+			if (from > first)
+				bits = from - first >= c_wordBlocks ? 0 : bits << (from - first);
+			if (to < first + c_wordBlocks - 1)
+				bits &= to < first ? 0 : ~uint64_t(0) >> (c_wordBlocks - 1 - (to - first));
+			result[w] = bits;
+		}
+
+		bool any = true;
+		for (auto const& entries: _filter)
+		{
+			if (entries.empty())
+				continue;
+			std::fill(group.begin(), group.end(), 0);
+			for (auto const& e: entries)
+			{
+				uint64_t const* r0 = rows + e[0] * m_sectionWords;
+				uint64_t const* r1 = rows + e[1] * m_sectionWords;
+				uint64_t const* r2 = rows + e[2] * m_sectionWords;
+				for (unsigned w = 0; w < m_sectionWords; ++w)
+					group[w] |= r0[w] & r1[w] & r2[w];
+			}
+			uint64_t left = 0;
+			for (unsigned w = 0; w < m_sectionWords; ++w)
+				left |= (result[w] &= group[w]);
+			if (!left)
+			{
+				any = false;
+				break;
+			}
+		}
+		if (!any)
+			continue;
+
+		for (unsigned w = 0; w < m_sectionWords; ++w)
+			for (uint64_t bits = result[w]; bits; bits &= bits - 1)
+				ret.push_back(m_firstBlock + base + uint64_t(w) * c_wordBlocks + lowestBit(bits));
+	}
+	return ret;
+}
@@ -0,0 +1,480 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file MemoryTrie.cpp
+ * @date 2018
+ */
+
+#include <eth-crypto/core/MemoryTrie.h>
+#include <eth-crypto/core/RLP.h>
+#include <eth-crypto/core/sha3_wrap.h>
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+using namespace dev;
+
+namespace
+{
+
+/// Number of nibbles of a key.
+unsigned const c_keyNibbles = 64;
+
+/// Below this many dirty nodes root() hashes on the calling thread only.
+size_t const c_minParallelDirty = 1024;
+
+/// m_values is compacted once this many bytes and at least half of it are unused.
+size_t const c_minCompact = 1 << 16;
+
+inline byte nibble(h256 const& _key, unsigned _i)
+{
+	return _i % 2 ? _key[_i / 2] & 0x0f : _key[_i / 2] >> 4;
+}
+
+/// @returns the first nibble in [@a _begin, @a _end) where @a _a and @a _b differ, @a _end if none.
+unsigned sharedNibbles(h256 const& _a, h256 const& _b, unsigned _begin, unsigned _end)
+{
+	for (; _begin < _end && nibble(_a, _begin) == nibble(_b, _begin); ++_begin) {}
+	return _begin;
+}
+
+}
+
+MemoryTrie::NodeIndex const MemoryTrie::c_null;
+
+MemoryTrie::NodeIndex MemoryTrie::newNode(Kind _kind, h256 const& _key, unsigned _begin, unsigned _end)
+{
+	NodeIndex n = m_freeNodes;
+	if (n != c_null)
+		m_freeNodes = m_nodes[n].link;
+	else
+	{
+		n = NodeIndex(m_nodes.size());
+		m_nodes.emplace_back();
+	}
+	Node& node = m_nodes[n];
+	node.key = _key;
+	node.kind = _kind;
+	node.dirty = true;
+	node.begin = byte(_begin);
+	node.end = byte(_end);
+	node.link = c_null;
+	node.valueSize = 0;
+	++m_dirty;
+	return n;
+}
+
+MemoryTrie::NodeIndex MemoryTrie::newLeaf(h256 const& _key, unsigned _begin, bytesConstRef _value)
+{
+	NodeIndex const n = newNode(Kind::Leaf, _key, _begin, c_keyNibbles);
+	setValue(n, _value);
+	return n;
+}
+
+MemoryTrie::NodeIndex MemoryTrie::newBranch(h256 const& _key, unsigned _begin)
+{
+	NodeIndex const n = newNode(Kind::Branch, _key, _begin, _begin);
+	NodeIndex slot;
+	if (!m_freeBranches.empty())
+	{
+		slot = m_freeBranches.back();
+		m_freeBranches.pop_back();
+	}
+	else
+	{
+		slot = NodeIndex(m_branches.size());
+		m_branches.emplace_back();
+	}
+	m_branches[slot].fill(c_null);
+	m_nodes[n].link = slot;
+	return n;
+}
+
+void MemoryTrie::freeNode(NodeIndex _n)
+{
+	Node& node = m_nodes[_n];
+	if (node.kind == Kind::Branch)
+		m_freeBranches.push_back(node.link);
+	m_garbage += node.valueSize;
+	if (node.dirty)
+		--m_dirty;
+	node.kind = Kind::Free;
+	node.link = m_freeNodes;
+	m_freeNodes = _n;
+}
+
+void MemoryTrie::markDirty(NodeIndex _n)
+{
+	if (!m_nodes[_n].dirty)
+	{
+		m_nodes[_n].dirty = true;
+		++m_dirty;
+	}
+}
+
+void MemoryTrie::setValue(NodeIndex _n, bytesConstRef _value)
+{
+	Node& node = m_nodes[_n];
+	m_garbage += node.valueSize;
+	node.valueOffset = uint32_t(m_values.size());
+	node.valueSize = uint32_t(_value.size());
+	m_values.insert(m_values.end(), _value.begin(), _value.end());
+}
+
+void MemoryTrie::compactValues()
+{
+	bytes values;
+	values.reserve(m_values.size() - m_garbage);
+	for (Node& n: m_nodes)
+		if (n.kind == Kind::Leaf)
+		{
+			bytesConstRef const v = value(n);
+			n.valueOffset = uint32_t(values.size());
+			values.insert(values.end(), v.begin(), v.end());
+		}
+	m_values.swap(values);
+	m_garbage = 0;
+}
+
+void MemoryTrie::insert(h256 const& _key, bytesConstRef _value)
+{
+	if (_value.empty())
+	{
+		remove(_key);
+		return;
+	}
+
+	// The value is about to be appended to m_values, which may move it.
+	if (_value.overlapsWith(bytesConstRef(&m_values)))
+	{
+		bytes const copy = _value.toBytes();
+		insert(_key, &copy);
+		return;
+	}
+
+	bytesConstRef const old = at(_key);
+	if (old.size() == _value.size() && std::equal(old.begin(), old.end(), _value.begin()))
+		return;
+	if (old.empty())
+		++m_size;
+	m_root = insertAt(m_root, _key, 0, _value);
+
+	if (m_garbage > c_minCompact && m_garbage * 2 > m_values.size())
+		compactValues();
+}
+
+bool MemoryTrie::remove(h256 const& _key)
+{
+	if (at(_key).empty())
+		return false;
+	m_root = removeAt(m_root, _key, 0);
+	--m_size;
+
+	if (m_garbage > c_minCompact && m_garbage * 2 > m_values.size())
+		compactValues();
+	return true;
+}
+
+bytesConstRef MemoryTrie::at(h256 const& _key) const
+{
+	NodeIndex n = m_root;
+	unsigned pos = 0;
+	while (n != c_null)
+	{
+		Node const& node = m_nodes[n];
+		switch (node.kind)
+		{
+		case Kind::Leaf:
+			return node.key == _key ? value(node) : bytesConstRef();
+		case Kind::Extension:
+			if (sharedNibbles(node.key, _key, pos, node.end) != node.end)
+				return bytesConstRef();
+			pos = node.end;
+			n = node.link;
+			break;
+		case Kind::Branch:
+			n = children(n)[nibble(_key, pos++)];
+			break;
+		case Kind::Free:
+			return bytesConstRef();
+		}
+	}
+	return bytesConstRef();
+}
+
+/// Stores @a _value under @a _key in the subtrie at @a _n, whose path starts at nibble @a _pos.
+/// @returns the node now heading the subtrie. Nodes are referred to by index only, since
+/// allocating may move the arena.
+MemoryTrie::NodeIndex MemoryTrie::insertAt(NodeIndex _n, h256 const& _key, unsigned _pos, bytesConstRef _value)
+{
+	if (_n == c_null)
+		return newLeaf(_key, _pos, _value);
+
+	switch (m_nodes[_n].kind)
+	{
+	case Kind::Leaf:
+	{
+		unsigned const p = sharedNibbles(m_nodes[_n].key, _key, _pos, c_keyNibbles);
+		if (p == c_keyNibbles)
+		{
+			setValue(_n, _value);
+			markDirty(_n);
+			return _n;
+		}
+		// Split at the first differing nibble.
+		NodeIndex const b = newBranch(_key, p);
+		NodeIndex const l = newLeaf(_key, p + 1, _value);
+		m_nodes[_n].begin = byte(p + 1);
+		markDirty(_n);
+		children(b)[nibble(m_nodes[_n].key, p)] = _n;
+		children(b)[nibble(_key, p)] = l;
+		if (p == _pos)
+			return b;
+		NodeIndex const e = newNode(Kind::Extension, _key, _pos, p);
+		m_nodes[e].link = b;
+		return e;
+	}
+	case Kind::Extension:
+	{
+		unsigned const end = m_nodes[_n].end;
+		unsigned const p = sharedNibbles(m_nodes[_n].key, _key, _pos, end);
+		if (p == end)
+		{
+			NodeIndex const c = insertAt(m_nodes[_n].link, _key, end, _value);
+			m_nodes[_n].link = c;
+			markDirty(_n);
+			return _n;
+		}
+		// Split the extension around the first differing nibble.
+		NodeIndex const b = newBranch(_key, p);
+		byte const restNibble = nibble(m_nodes[_n].key, p);
+		NodeIndex rest = _n;
+		if (p + 1 < end)
+		{
+			m_nodes[_n].begin = byte(p + 1);
+			markDirty(_n);
+		}
+		else
+		{
+			rest = m_nodes[_n].link;
+			freeNode(_n);
+		}
+		NodeIndex const l = newLeaf(_key, p + 1, _value);
+		children(b)[restNibble] = rest;
+		children(b)[nibble(_key, p)] = l;
+		if (p == _pos)
+			return b;
+		NodeIndex const e = newNode(Kind::Extension, _key, _pos, p);
+		m_nodes[e].link = b;
+		return e;
+	}
+	case Kind::Branch:
+	{
+		byte const i = nibble(_key, _pos);
+		NodeIndex const c = insertAt(children(_n)[i], _key, _pos + 1, _value);
+		children(_n)[i] = c;
+		markDirty(_n);
+		return _n;
+	}
+	case Kind::Free:
+		break;
+	}
+	return _n;
+}
+
+/// Removes @a _key, which must be present, from the subtrie at @a _n, whose path starts at
+/// nibble @a _pos. Branches left with a single child are folded into their neighbours.
+/// @returns the node now heading the subtrie, c_null if it is empty.
+MemoryTrie::NodeIndex MemoryTrie::removeAt(NodeIndex _n, h256 const& _key, unsigned _pos)
+{
+	switch (m_nodes[_n].kind)
+	{
+	case Kind::Leaf:
+		freeNode(_n);
+		return c_null;
+	case Kind::Extension:
+	{
+		NodeIndex const c = removeAt(m_nodes[_n].link, _key, m_nodes[_n].end);
+		// The child was a branch; if it folded into a leaf or extension, that takes our path.
+		if (m_nodes[c].kind != Kind::Branch)
+		{
+			m_nodes[c].begin = m_nodes[_n].begin;
+			markDirty(c);
+			freeNode(_n);
+			return c;
+		}
+		m_nodes[_n].link = c;
+		markDirty(_n);
+		return _n;
+	}
+	case Kind::Branch:
+	{
+		byte const i = nibble(_key, _pos);
+		NodeIndex const c = removeAt(children(_n)[i], _key, _pos + 1);
+		children(_n)[i] = c;
+		markDirty(_n);
+
+		unsigned count = 0;
+		unsigned last = 0;
+		for (unsigned j = 0; j < 16; ++j)
+			if (children(_n)[j] != c_null)
+			{
+				++count;
+				last = j;
+			}
+		if (count > 1)
+			return _n;
+
+		// A single child left: its path absorbs ours, or we become a one nibble extension.
+		NodeIndex const only = children(_n)[last];
+		if (m_nodes[only].kind != Kind::Branch)
+		{
+			m_nodes[only].begin = byte(_pos);
+			markDirty(only);
+			freeNode(_n);
+			return only;
+		}
+		m_freeBranches.push_back(m_nodes[_n].link);
+		Node& node = m_nodes[_n];
+		node.kind = Kind::Extension;
+		node.key = m_nodes[only].key;
+		node.begin = byte(_pos);
+		node.end = byte(_pos + 1);
+		node.link = only;
+		return _n;
+	}
+	case Kind::Free:
+		break;
+	}
+	return _n;
+}
+
+void MemoryTrie::appendRef(RLPStream& _s, NodeIndex _n) const
+{
+	Node const& node = m_nodes[_n];
+	if (node.refSize == 32)
+		_s << node.ref;
+	else
+		_s.appendRaw(bytesConstRef(node.ref.data(), node.refSize));
+}
+
+/// Hashes the dirty children of branch @a _n, spreading them over @a _threads threads.
+void MemoryTrie::hashChildren(NodeIndex _n, unsigned _threads)
+{
+	std::vector<NodeIndex> dirty;
+	for (NodeIndex c: children(_n))
+		if (c != c_null && m_nodes[c].dirty)
+			dirty.push_back(c);
+
+	if (_threads < 2 || dirty.size() < 2 || m_dirty < c_minParallelDirty)
+	{
+		for (NodeIndex c: dirty)
+			hashNode(c, _threads);
+		return;
+	}
+
+	// Subtries are disjoint and hashing never allocates nodes, so workers need no locking.
+	size_t const workers = std::min<size_t>(_threads, dirty.size());
+	unsigned const budget = std::max<unsigned>(1, _threads / unsigned(workers));
+	auto work = [&](size_t _worker)
+	{
+		for (size_t i = dirty.size() * _worker / workers; i < dirty.size() * (_worker + 1) / workers; ++i)
+			hashNode(dirty[i], budget);
+	};
+	std::vector<std::thread> threads;
+	for (size_t w = 1; w < workers; ++w)
+		threads.emplace_back(work, w);
+	work(0);
+	for (auto& t: threads)
+		t.join();
+}
+
+/// Computes the reference of @a _n and of the dirty nodes below it.
+void MemoryTrie::hashNode(NodeIndex _n, unsigned _threads)
+{
+	if (!m_nodes[_n].dirty)
+		return;
+
+	Node& node = m_nodes[_n];
+	RLPStream s;
+	byte path[c_keyNibbles];
+	for (unsigned i = node.begin; i < node.end; ++i)
+		path[i - node.begin] = nibble(node.key, i);
+	bytesConstRef const pathRef(path, node.end - node.begin);
+
+	switch (node.kind)
+	{
+	case Kind::Leaf:
+		s.appendList(2) << hexPrefixEncode(pathRef, true) << value(node);
+		break;
+	case Kind::Extension:
+		hashNode(node.link, _threads);
+		s.appendList(2) << hexPrefixEncode(pathRef, false);
+		appendRef(s, node.link);
+		break;
+	case Kind::Branch:
+		hashChildren(_n, _threads);
+		s.appendList(17);
+		for (NodeIndex c: children(_n))
+			if (c == c_null)
+				s << "";
+			else
+				appendRef(s, c);
+		s << "";
+		break;
+	case Kind::Free:
+		break;
+	}
+
+	bytes const& out = s.out();
+	if (out.size() < 32)
+	{
+		memcpy(node.ref.data(), out.data(), out.size());
+		node.refSize = byte(out.size());
+	}
+	else
+	{
+		node.ref = ethash::sha3_ethash(out);
+		node.refSize = 32;
+	}
+	node.dirty = false;
+}
+
+h256 MemoryTrie::root(unsigned _threads)
+{
+	if (m_root == c_null)
+		return EmptyTrie;
+	if (!_threads)
+		_threads = std::max(1u, std::thread::hardware_concurrency());
+
+	hashNode(m_root, _threads);
+	m_dirty = 0;
+	Node const& r = m_nodes[m_root];
+	return r.refSize == 32 ? r.ref : ethash::sha3_ethash(bytesConstRef(r.ref.data(), r.refSize));
+}
+
+void MemoryTrie::clear()
+{
+	m_nodes.clear();
+	m_branches.clear();
+	m_freeNodes = c_null;
+	m_freeBranches.clear();
+	m_values.clear();
+	m_garbage = 0;
+	m_root = c_null;
+	m_size = 0;
+	m_dirty = 0;
+}
@@ -20,6 +20,10 @@
  */
 
 #include <eth-crypto/core/RLP.h>
+#include <algorithm>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 using namespace std;
 using namespace dev;
 
@@ -38,8 +42,11 @@ errinfo_comment constructRLPSizeErrorInfo(size_t _actualSize, size_t _dataSize)
 }
 
 RLP::RLP(bytesConstRef _d, Strictness _s):
-	m_data(_d)
+	m_data(_d),
+	m_trusted(_s & Trusted)
 {
+	if (m_trusted)
+		return;
 	if ((_s & FailIfTooBig) && actualSize() < _d.size())
 	{
 		if (_s & ThrowOnFail)
@@ -61,7 +68,7 @@ RLP::iterator& RLP::iterator::operator++()
 	if (m_remaining)
 	{
 		m_currentItem.retarget(m_currentItem.next().data(), m_remaining);
-		m_currentItem = m_currentItem.cropped(0, sizeAsEncoded(m_currentItem));
+		m_currentItem = m_currentItem.cropped(0, sizeAsEncoded(m_currentItem, m_trusted ? Trusted : ThrowOnFail | FailIfTooSmall));
 		m_remaining -= std::min<size_t>(m_remaining, m_currentItem.size());
 	}
 	else
@@ -69,12 +76,13 @@ RLP::iterator& RLP::iterator::operator++()
 	return *this;
 }
 
-RLP::iterator::iterator(RLP const& _parent, bool _begin)
+RLP::iterator::iterator(RLP const& _parent, bool _begin):
+	m_trusted(_parent.m_trusted)
 {
 	if (_begin && _parent.isList())
 	{
 		auto pl = _parent.payload();
-		m_currentItem = pl.cropped(0, sizeAsEncoded(pl));
+		m_currentItem = pl.cropped(0, sizeAsEncoded(pl, _parent.itemStrictness()));
 		m_remaining = pl.size() - m_currentItem.size();
 	}
 	else
@@ -88,17 +96,37 @@ RLP RLP::operator[](size_t _i) const
 {
 	if (_i < m_lastIndex)
 	{
-		m_lastEnd = sizeAsEncoded(payload());
+		m_lastEnd = sizeAsEncoded(payload(), itemStrictness());
 		m_lastItem = payload().cropped(0, m_lastEnd);
 		m_lastIndex = 0;
 	}
 	for (; m_lastIndex < _i && m_lastItem.size(); ++m_lastIndex)
 	{
 		m_lastItem = payload().cropped(m_lastEnd);
-		m_lastItem = m_lastItem.cropped(0, sizeAsEncoded(m_lastItem));
+		m_lastItem = m_lastItem.cropped(0, sizeAsEncoded(m_lastItem, itemStrictness()));
 		m_lastEnd += m_lastItem.size();
 	}
-	return RLP(m_lastItem, ThrowOnFail | FailIfTooSmall);
+	return RLP(m_lastItem, itemStrictness());
+}
+
+RLPIndex RLP::indexed() const
+{
+	return RLPIndex(*this);
+}
+
+RLPIndex::RLPIndex(RLP const& _list)
+{
+	if (!_list.isList())
+		return;
+	m_payload = _list.payload();
+	if (_list.m_trusted)
+		m_itemStrictness = RLP::Trusted;
+	for (size_t offset = 0; offset < m_payload.size();)
+	{
+		size_t const size = RLP::sizeAsEncoded(m_payload.cropped(offset), _list.itemStrictness());
+		m_items.push_back(Item{offset, size});
+		offset += size;
+	}
 }
 
 RLPs RLP::toList(int _flags) const
@@ -129,6 +157,8 @@ size_t RLP::actualSize() const
 
 void RLP::requireGood() const
 {
+	if (m_trusted)
+		return;
 	if (isNull())
 		BOOST_THROW_EXCEPTION(BadRLP());
 	byte n = m_data[0];
@@ -174,6 +204,12 @@ size_t RLP::length() const
 	requireGood();
 	size_t ret = 0;
 	byte const n = m_data[0];
+	if (m_trusted && lengthSize())
+	{
+		for (unsigned i = 0; i < lengthSize(); ++i)
+			ret = (ret << 8) | m_data[i + 1];
+		return ret;
+	}
 	if (n < c_rlpDataImmLenStart)
 		return 1;
 	else if (n <= c_rlpDataIndLenZero)
@@ -245,6 +281,45 @@ RLPStream& RLPStream::appendRaw(bytesConstRef _s, size_t _itemCount)
 	return *this;
 }
 
+namespace
+{
+
+/// Largest list header: the prefix byte and up to c_rlpMaxLengthBytes length bytes.
+size_t const c_maxListHeader = 1 + c_rlpMaxLengthBytes;
+
+/// @returns the number of leading zero bytes of @a _x, which must not be zero.
+inline unsigned leadingZeroBytes(uint64_t _x)
+{
+#if defined(_MSC_VER)
+	unsigned long i;
+	_BitScanReverse64(&i, _x);
+	return (63 - i) / 8;
+#else
+	return __builtin_clzll(_x) / 8;
+#endif
+}
+
+/// @returns @a _x laid out big-endian in memory.
+inline uint64_t bigEndian64(uint64_t _x)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	return _x;
+#elif defined(_MSC_VER)
+	return _byteswap_uint64(_x);
+#else
+	return __builtin_bswap64(_x);
+#endif
+}
+
+/// Writes the low @a _bytes bytes of @a _x to @a _out, big-endian.
+inline void storeBigEndian(byte* _out, uint64_t _x, unsigned _bytes)
+{
+	uint64_t const be = bigEndian64(_x);
+	memcpy(_out, reinterpret_cast<byte const*>(&be) + sizeof(be) - _bytes, _bytes);
+}
+
+}
+
 void RLPStream::noteAppended(size_t _itemCount)
 {
 	if (!_itemCount)
@@ -252,43 +327,89 @@ void RLPStream::noteAppended(size_t _itemCount)
 //	cdebug << "noteAppended(" << _itemCount << ")";
 	while (m_listStack.size())
 	{
-		if (m_listStack.back().first < _itemCount)
-			BOOST_THROW_EXCEPTION(RLPException() << errinfo_comment("itemCount too large") << RequirementError((bigint)m_listStack.back().first, (bigint)_itemCount));
-		m_listStack.back().first -= _itemCount;
-		if (m_listStack.back().first)
+		if (m_listStack.back().items < _itemCount)
+			BOOST_THROW_EXCEPTION(RLPException() << errinfo_comment("itemCount too large") << RequirementError((bigint)m_listStack.back().items, (bigint)_itemCount));
+		m_listStack.back().items -= _itemCount;
+		if (m_listStack.back().items)
 			break;
 		else
 		{
-			auto p = m_listStack.back().second;
+			OpenList const l = m_listStack.back();
 			m_listStack.pop_back();
-			size_t s = m_out.size() - p;		// list size
+			// The payload follows the header slot; gaps of inner lists are not part of it.
+			size_t s = m_out.size() - l.pos - c_maxListHeader - (m_gapBytes - l.gapBytes);
 			auto brs = bytesRequired(s);
 			unsigned encodeSize = s < c_rlpListImmLenCount ? 1 : (1 + brs);
-//			cdebug << "s: " << s << ", p: " << p << ", m_out.size(): " << m_out.size() << ", encodeSize: " << encodeSize << " (br: " << brs << ")";
-			auto os = m_out.size();
-			m_out.resize(os + encodeSize);
-			memmove(m_out.data() + p + encodeSize, m_out.data() + p, os - p);
+			if (encodeSize > c_maxListHeader)
+				BOOST_THROW_EXCEPTION(RLPException() << errinfo_comment("itemCount too large for RLP"));
+			size_t const p = l.pos + c_maxListHeader - encodeSize;
 			if (s < c_rlpListImmLenCount)
 				m_out[p] = (byte)(c_rlpListStart + s);
-			else if (c_rlpListIndLenZero + brs <= 0xff)
+			else
 			{
 				m_out[p] = (byte)(c_rlpListIndLenZero + brs);
 				byte* b = &(m_out[p + brs]);
 				for (; s; s >>= 8)
 					*(b--) = (byte)s;
 			}
-			else
-				BOOST_THROW_EXCEPTION(RLPException() << errinfo_comment("itemCount too large for RLP"));
+			m_gaps.push_back(Gap{l.pos, c_maxListHeader - encodeSize});
+			m_gapBytes += c_maxListHeader - encodeSize;
 		}
 		_itemCount = 1;	// for all following iterations, we've effectively appended a single item only since we completed a list.
 	}
+	if (m_listStack.empty())
+	{
+		if (!m_gaps.empty())
+			compact();
+		if (m_sink)
+			flush();
+	}
+}
+
+void RLPStream::flush()
+{
+	if (!m_out.empty() && !m_sink->put(&m_out))
+		m_overflow = true;
+	m_out.clear();
+}
+
+bool RLPBufferSink::put(bytesConstRef _rlp)
+{
+	if (m_overflow || _rlp.size() > m_buffer.size() - m_size)
+	{
+		m_overflow = true;
+		return false;
+	}
+	memcpy(m_buffer.data() + m_size, _rlp.data(), _rlp.size());
+	m_size += _rlp.size();
+	return true;
+}
+
+void RLPStream::compact()
+{
+	// Inner lists close before the ones around them, so the gaps need sorting.
+	std::sort(m_gaps.begin(), m_gaps.end(), [](Gap const& _a, Gap const& _b) { return _a.pos < _b.pos; });
+	size_t to = m_gaps.front().pos;
+	for (size_t i = 0; i < m_gaps.size(); ++i)
+	{
+		size_t const from = m_gaps[i].pos + m_gaps[i].size;
+		size_t const end = i + 1 < m_gaps.size() ? m_gaps[i + 1].pos : m_out.size();
+		memmove(m_out.data() + to, m_out.data() + from, end - from);
+		to += end - from;
+	}
+	m_out.resize(to);
+	m_gaps.clear();
+	m_gapBytes = 0;
 }
 
 RLPStream& RLPStream::appendList(size_t _items)
 {
 //	cdebug << "appendList(" << _items << ")";
 	if (_items)
-		m_listStack.push_back(std::make_pair(_items, m_out.size()));
+	{
+		m_listStack.push_back(OpenList{_items, m_out.size(), m_gapBytes});
+		m_out.resize(m_out.size() + c_maxListHeader);
+	}
 	else
 		appendList(bytes());
 	return *this;
@@ -350,6 +471,48 @@ RLPStream& RLPStream::append(bigint _i)
 	return *this;
 }
 
+RLPStream& RLPStream::appendInt(uint64_t _i)
+{
+	if (!_i)
+		m_out.push_back(c_rlpDataImmLenStart);
+	else if (_i < c_rlpDataImmLenStart)
+		m_out.push_back((byte)_i);
+	else
+	{
+		unsigned const br = sizeof(_i) - leadingZeroBytes(_i);
+		size_t const p = m_out.size();
+		m_out.resize(p + 1 + br);
+		m_out[p] = (byte)(c_rlpDataImmLenStart + br);
+		storeBigEndian(m_out.data() + p + 1, _i, br);
+	}
+	noteAppended();
+	return *this;
+}
+
+RLPStream& RLPStream::appendLimbs(boost::multiprecision::limb_type const* _limbs, size_t _count)
+{
+	static_assert(sizeof(*_limbs) <= sizeof(uint64_t), "limbs wider than 64 bits");
+	while (_count > 1 && !_limbs[_count - 1])
+		--_count;
+	if (_count == 1)
+		return appendInt(_limbs[0]);
+
+	// Fixed width integers are at most 32 bytes, so the length always fits the prefix byte.
+	size_t const limbBytes = sizeof(*_limbs);
+	unsigned const topBytes = sizeof(uint64_t) - leadingZeroBytes(_limbs[_count - 1]);
+	size_t const br = (_count - 1) * limbBytes + topBytes;
+	size_t const p = m_out.size();
+	m_out.resize(p + 1 + br);
+	m_out[p] = (byte)(c_rlpDataImmLenStart + br);
+	byte* out = m_out.data() + p + 1;
+	storeBigEndian(out, _limbs[_count - 1], topBytes);
+	out += topBytes;
+	for (size_t i = _count - 1; i--; out += limbBytes)
+		storeBigEndian(out, _limbs[i], limbBytes);
+	noteAppended();
+	return *this;
+}
+
 void RLPStream::pushCount(size_t _count, byte _base)
 {
 	auto br = bytesRequired(_count);
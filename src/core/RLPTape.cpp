@@ -0,0 +1,114 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file RLPTape.cpp
+ * @date 2018
+ */
+
+#include <eth-crypto/core/RLPTape.h>
+using namespace std;
+using namespace dev;
+
+namespace
+{
+
+/// Reads the big-endian length of @a _size bytes at @a _p, which must be canonical:
+/// no leading zero, at most a size_t, and too long for the short form.
+size_t readLength(byte const* _p, unsigned _size)
+{
+	if (!_p[0])
+		BOOST_THROW_EXCEPTION(BadRLP() << errinfo_comment("leading zero in RLP length"));
+	if (_size > sizeof(size_t))
+		BOOST_THROW_EXCEPTION(UndersizeRLP());
+	size_t ret = 0;
+	for (unsigned i = 0; i < _size; ++i)
+		ret = (ret << 8) | _p[i];
+	if (ret < c_rlpDataImmLenCount)
+		BOOST_THROW_EXCEPTION(BadRLP() << errinfo_comment("RLP long form for a short item"));
+	return ret;
+}
+
+}
+
+RLPTape::RLPTape(bytesConstRef _data, unsigned _maxDepth):
+	m_data(_data)
+{
+	struct Open
+	{
+		size_t entry;
+		size_t end;
+	};
+	vector<Open> open;
+	byte const* d = _data.data();
+	size_t const size = _data.size();
+	size_t pos = 0;
+	while (true)
+	{
+		while (!open.empty() && pos == open.back().end)
+		{
+			m_tape[open.back().entry].next = m_tape.size();
+			open.pop_back();
+		}
+		if (pos == size)
+			break;
+
+		size_t const limit = open.empty() ? size : open.back().end;
+		byte const n = d[pos];
+		Entry e{pos, pos + 1, 0, 0, 0, n >= c_rlpListStart};
+		size_t length;
+		if (n < c_rlpDataImmLenStart)
+		{
+			e.payload = pos;
+			length = 1;
+		}
+		else if (n <= c_rlpDataIndLenZero || (n >= c_rlpListStart && n <= c_rlpListIndLenZero))
+		{
+			length = n - (e.list ? c_rlpListStart : c_rlpDataImmLenStart);
+			if (length == 1 && !e.list && pos + 1 < limit && d[pos + 1] < c_rlpDataImmLenStart)
+				BOOST_THROW_EXCEPTION(BadRLP() << errinfo_comment("RLP single byte not encoded as itself"));
+		}
+		else
+		{
+			unsigned const lengthSize = n - (e.list ? c_rlpListIndLenZero : c_rlpDataIndLenZero);
+			if (lengthSize >= limit - pos)
+				BOOST_THROW_EXCEPTION(UndersizeRLP());
+			length = readLength(d + pos + 1, lengthSize);
+			e.payload += lengthSize;
+		}
+		if (length > limit - e.payload)
+			BOOST_THROW_EXCEPTION(UndersizeRLP());
+		e.end = e.payload + length;
+
+		size_t const index = m_tape.size();
+		if (open.empty())
+			m_top.push_back(index);
+		else
+			++m_tape[open.back().entry].items;
+		if (e.list)
+		{
+			if (open.size() == _maxDepth)
+				BOOST_THROW_EXCEPTION(BadRLP() << errinfo_comment("RLP nested too deeply"));
+			open.push_back(Open{index, e.end});
+			pos = e.payload;
+		}
+		else
+		{
+			e.next = index + 1;
+			pos = e.end;
+		}
+		m_tape.push_back(e);
+	}
+}
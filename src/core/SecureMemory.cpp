@@ -0,0 +1,207 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file SecureMemory.cpp
+ * @date 2018
+ */
+
+#include <eth-crypto/core/SecureMemory.h>
+#include <algorithm>
+#include <cstring>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace dev;
+
+namespace
+{
+
+size_t const c_minBlock = 16;
+
+/// Called through a volatile pointer so that the wipe cannot be elided as a dead store.
+void* (*volatile s_memset)(void*, int, size_t) = &memset;
+
+size_t pageSize()
+{
+#if defined(_WIN32)
+	static size_t const s_size = []{ SYSTEM_INFO info; GetSystemInfo(&info); return size_t(info.dwPageSize); }();
+#else
+	static size_t const s_size = size_t(sysconf(_SC_PAGESIZE));
+#endif
+	return s_size;
+}
+
+size_t roundToPages(size_t _size)
+{
+	size_t const page = pageSize();
+	return (_size + page - 1) / page * page;
+}
+
+}
+
+void dev::secureWipe(void* _p, size_t _size)
+{
+	s_memset(_p, 0, _size);
+}
+
+SecureArena& SecureArena::instance()
+{
+	static SecureArena* s_arena = new SecureArena;
+	return *s_arena;
+}
+
+SecureArena::SecureArena(size_t _chunkSize):
+	m_chunkSize(roundToPages(std::max(_chunkSize, size_t(c_minBlock) << (c_classCount - 1))))
+{
+}
+
+SecureArena::~SecureArena()
+{
+	for (auto const& r: m_chunks)
+		unmap(r);
+	for (auto const& r: m_large)
+		unmap(r);
+}
+
+size_t SecureArena::sizeClass(size_t _size)
+{
+	size_t c = 0;
+	for (size_t block = c_minBlock; block < _size && c < c_classCount; block <<= 1)
+		++c;
+	return c;
+}
+
+SecureArena::Region SecureArena::map(size_t _size)
+{
+	size_t const page = pageSize();
+	size_t const total = _size + 2 * page;
+	Region ret;
+	ret.size = total;
+#if defined(_WIN32)
+	ret.base = static_cast<char*>(VirtualAlloc(nullptr, total, MEM_RESERVE | MEM_COMMIT, PAGE_NOACCESS));
+	DWORD old;
+	if (!ret.base)
+		throw std::bad_alloc();
+	if (!VirtualProtect(ret.base + page, _size, PAGE_READWRITE, &old))
+	{
+		VirtualFree(ret.base, 0, MEM_RELEASE);
+		throw std::bad_alloc();
+	}
+	if (!VirtualLock(ret.base + page, _size))
+		++m_lockFailures;
+#else
+	void* p = mmap(nullptr, total, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		throw std::bad_alloc();
+	ret.base = static_cast<char*>(p);
+	if (mprotect(ret.base + page, _size, PROT_READ | PROT_WRITE))
+	{
+		munmap(p, total);
+		throw std::bad_alloc();
+	}
+	if (mlock(ret.base + page, _size))
+		++m_lockFailures;
+#if defined(MADV_DONTDUMP)
+	// Keep key material out of core dumps.
+	madvise(ret.base + page, _size, MADV_DONTDUMP);
+#endif
+#endif
+	m_mapped += _size;
+	return ret;
+}
+
+void SecureArena::unmap(Region const& _r) noexcept
+{
+	size_t const page = pageSize();
+	size_t const usable = _r.size - 2 * page;
+	secureWipe(_r.base + page, usable);
+#if defined(_WIN32)
+	VirtualUnlock(_r.base + page, usable);
+	VirtualFree(_r.base, 0, MEM_RELEASE);
+#else
+	munlock(_r.base + page, usable);
+	munmap(_r.base, _r.size);
+#endif
+	m_mapped -= usable;
+}
+
+void* SecureArena::allocate(size_t _size)
+{
+	size_t const c = sizeClass(std::max<size_t>(_size, 1));
+	lock_guard<mutex> l(x_arena);
+	if (c == c_classCount)
+	{
+		Region r = map(roundToPages(_size));
+		m_large.push_back(r);
+		return r.base + pageSize();
+	}
+
+	if (void* p = m_free[c])
+	{
+		m_free[c] = *static_cast<void**>(p);
+		*static_cast<void**>(p) = nullptr;
+		return p;
+	}
+
+	size_t const block = c_minBlock << c;
+	if (size_t(m_bumpEnd - m_bump) < block)
+	{
+		// The tail of the old chunk is too small for this class; hand it to the smaller ones.
+		for (size_t s = c; s-- > 0;)
+			while (size_t(m_bumpEnd - m_bump) >= (c_minBlock << s))
+			{
+				*reinterpret_cast<void**>(m_bump) = m_free[s];
+				m_free[s] = m_bump;
+				m_bump += c_minBlock << s;
+			}
+		Region r = map(m_chunkSize);
+		m_chunks.push_back(r);
+		m_bump = r.base + pageSize();
+		m_bumpEnd = m_bump + m_chunkSize;
+	}
+	void* ret = m_bump;
+	m_bump += block;
+	return ret;
+}
+
+void SecureArena::deallocate(void* _p, size_t _size) noexcept
+{
+	if (!_p)
+		return;
+	size_t const c = sizeClass(std::max<size_t>(_size, 1));
+	lock_guard<mutex> l(x_arena);
+	if (c == c_classCount)
+	{
+		char* base = static_cast<char*>(_p) - pageSize();
+		for (auto it = m_large.begin(); it != m_large.end(); ++it)
+			if (it->base == base)
+			{
+				unmap(*it);
+				m_large.erase(it);
+				break;
+			}
+		return;
+	}
+
+	secureWipe(_p, c_minBlock << c);
+	*static_cast<void**>(_p) = m_free[c];
+	m_free[c] = _p;
+}
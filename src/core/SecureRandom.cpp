@@ -0,0 +1,208 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file SecureRandom.cpp
+ * @date 2018
+ */
+
+#include <eth-crypto/core/SecureRandom.h>
+#include <array>
+#include <atomic>
+#include <random>
+#if !defined(_WIN32)
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace dev;
+
+namespace
+{
+
+/// Keystream bytes handed out between two reseeds from the OS.
+size_t const c_reseedInterval = 1 << 24;
+
+inline uint32_t rotl(uint32_t _x, int _n)
+{
+	return (_x << _n) | (_x >> (32 - _n));
+}
+
+inline void quarterRound(uint32_t* _s, int _a, int _b, int _c, int _d)
+{
+	_s[_a] += _s[_b]; _s[_d] = rotl(_s[_d] ^ _s[_a], 16);
+	_s[_c] += _s[_d]; _s[_b] = rotl(_s[_b] ^ _s[_c], 12);
+	_s[_a] += _s[_b]; _s[_d] = rotl(_s[_d] ^ _s[_a], 8);
+	_s[_c] += _s[_d]; _s[_b] = rotl(_s[_b] ^ _s[_c], 7);
+}
+
+/// Bumped in the child after every fork, so that the child's generators reseed
+/// instead of repeating the parent's keystream. Cheaper to check than getpid(),
+/// which is a system call on current glibc.
+std::atomic<unsigned> s_forkGeneration{0};
+
+#if !defined(_WIN32)
+void onForkChild()
+{
+	s_forkGeneration.fetch_add(1, std::memory_order_relaxed);
+}
+#endif
+
+/// @returns whether fork detection works, registering the handler on the first call.
+bool forkHandlerRegistered()
+{
+#if defined(_WIN32)
+	return true;
+#else
+	static bool const s_registered = pthread_atfork(nullptr, nullptr, onForkChild) == 0;
+	return s_registered;
+#endif
+}
+
+int currentProcess()
+{
+#if defined(_WIN32)
+	return 0;
+#else
+	return getpid();
+#endif
+}
+
+/**
+ * @brief ChaCha20 keystream generator with fast key erasure.
+ * Each refill produces a few blocks; the first 32 bytes become the next key and the
+ * rest is handed out and wiped as it is consumed.
+ */
+class ChaCha20Drbg
+{
+public:
+	ChaCha20Drbg(): m_checkPid(!forkHandlerRegistered()) { reseed(); }
+	~ChaCha20Drbg() { bytesRef(m_key.data(), m_key.size()).cleanse(); bytesRef(m_buffer.data(), m_buffer.size()).cleanse(); }
+
+	void fill(bytesRef o_out)
+	{
+		if (m_forkGeneration != s_forkGeneration.load(std::memory_order_relaxed) || m_sinceReseed >= c_reseedInterval || (m_checkPid && m_pid != currentProcess()))
+			reseed();
+		m_sinceReseed += o_out.size();
+
+		byte* out = o_out.data();
+		size_t left = o_out.size();
+		while (left)
+		{
+			if (m_used == m_buffer.size())
+				refill();
+			size_t const n = std::min(left, m_buffer.size() - m_used);
+			memcpy(out, m_buffer.data() + m_used, n);
+			memset(m_buffer.data() + m_used, 0, n);
+			m_used += n;
+			out += n;
+			left -= n;
+		}
+	}
+
+	void reseed()
+	{
+		// Mixed into the current key, so a weak OS source cannot make things worse.
+		std::random_device rd;
+		for (size_t i = 0; i < m_key.size(); i += 4)
+		{
+			uint32_t const r = rd();
+			for (size_t j = 0; j < 4; ++j)
+				m_key[i + j] ^= static_cast<byte>(r >> (8 * j));
+		}
+		m_forkGeneration = s_forkGeneration.load(std::memory_order_relaxed);
+		if (m_checkPid)
+			m_pid = currentProcess();
+		m_sinceReseed = 0;
+		// Drop output derived from the old key.
+		bytesRef(m_buffer.data(), m_buffer.size()).cleanse();
+		m_used = m_buffer.size();
+	}
+
+private:
+	static size_t const c_blocks = 8;
+
+	void refill()
+	{
+		std::array<byte, 64 * c_blocks> stream;
+		for (size_t b = 0; b < c_blocks; ++b)
+			block(b, stream.data() + 64 * b);
+		memcpy(m_key.data(), stream.data(), m_key.size());
+		memcpy(m_buffer.data(), stream.data() + m_key.size(), m_buffer.size());
+		bytesRef(stream.data(), stream.size()).cleanse();
+		m_used = 0;
+	}
+
+	/// Writes block number @a _counter of the keystream under the current key, with a zero nonce.
+	void block(uint32_t _counter, byte* o_out) const
+	{
+		uint32_t in[16] = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574};
+		for (unsigned i = 0; i < 8; ++i)
+			in[4 + i] = uint32_t(m_key[4 * i]) | uint32_t(m_key[4 * i + 1]) << 8 | uint32_t(m_key[4 * i + 2]) << 16 | uint32_t(m_key[4 * i + 3]) << 24;
+		in[12] = _counter;
+		in[13] = in[14] = in[15] = 0;
+
+		uint32_t x[16];
+		memcpy(x, in, sizeof(x));
+		for (unsigned i = 0; i < 10; ++i)
+		{
+			quarterRound(x, 0, 4, 8, 12);
+			quarterRound(x, 1, 5, 9, 13);
+			quarterRound(x, 2, 6, 10, 14);
+			quarterRound(x, 3, 7, 11, 15);
+			quarterRound(x, 0, 5, 10, 15);
+			quarterRound(x, 1, 6, 11, 12);
+			quarterRound(x, 2, 7, 8, 13);
+			quarterRound(x, 3, 4, 9, 14);
+		}
+		for (unsigned i = 0; i < 16; ++i)
+		{
+			uint32_t const v = x[i] + in[i];
+			o_out[4 * i] = byte(v);
+			o_out[4 * i + 1] = byte(v >> 8);
+			o_out[4 * i + 2] = byte(v >> 16);
+			o_out[4 * i + 3] = byte(v >> 24);
+		}
+		bytesRef(reinterpret_cast<byte*>(x), sizeof(x)).cleanse();
+		bytesRef(reinterpret_cast<byte*>(in), sizeof(in)).cleanse();
+	}
+
+	std::array<byte, 32> m_key{};
+	std::array<byte, 64 * c_blocks - 32> m_buffer{};
+	size_t m_used = 0;
+	size_t m_sinceReseed = 0;
+	unsigned m_forkGeneration = 0;
+	bool m_checkPid;	///< Falls back to comparing pids if the fork handler could not be registered.
+	int m_pid = 0;
+};
+
+ChaCha20Drbg& threadDrbg()
+{
+	thread_local ChaCha20Drbg t_drbg;
+	return t_drbg;
+}
+
+}
+
+void dev::secureRandom(bytesRef o_out)
+{
+	threadDrbg().fill(o_out);
+}
+
+void dev::reseedSecureRandom()
+{
+	threadDrbg().reseed();
+}
@@ -0,0 +1,143 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file SenderCache.cpp
+ * @date 2018
+ */
+
+#include <eth-crypto/core/SenderCache.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+SenderCache& SenderCache::instance()
+{
+	static SenderCache s_cache;
+	return s_cache;
+}
+
+SenderCache::SenderCache(size_t _capacity, unsigned _shards):
+	m_shards(new Shard[std::max(1u, _shards)]),
+	m_shardCount(std::max(1u, _shards)),
+	m_capacity(0)
+{
+	setCapacity(_capacity);
+}
+
+SenderCache::Key SenderCache::makeKey(SignatureStruct const& _sig, h256 const& _hash)
+{
+	Key ret;
+	memcpy(ret.data(), &_sig, sizeof(Signature));
+	memcpy(ret.data() + sizeof(Signature), _hash.data(), h256::size);
+	return ret;
+}
+
+SenderCache::Shard& SenderCache::shardFor(Key const& _k)
+{
+	// Pick the shard from the signing hash so it is independent of the in-shard hash.
+	uint32_t h;
+	memcpy(&h, _k.data() + sizeof(Signature), sizeof(h));
+	return m_shards[h % m_shardCount];
+}
+
+void SenderCache::Shard::evictTo(size_t _size)
+{
+	while (entries.size() > _size)
+	{
+		index.erase(entries.back().first);
+		entries.pop_back();
+	}
+}
+
+bool SenderCache::lookup(SignatureStruct const& _sig, h256 const& _hash, Address& o_sender)
+{
+	if (!m_capacity)
+		return false;
+
+	Key const k = makeKey(_sig, _hash);
+	Shard& shard = shardFor(k);
+	{
+		lock_guard<mutex> l(shard.x_entries);
+		auto it = shard.index.find(k);
+		if (it != shard.index.end())
+		{
+			shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+			o_sender = it->second->second;
+			++m_hits;
+			return true;
+		}
+	}
+	++m_misses;
+	return false;
+}
+
+void SenderCache::insert(SignatureStruct const& _sig, h256 const& _hash, Address const& _sender)
+{
+	if (!m_capacity)
+		return;
+
+	Key const k = makeKey(_sig, _hash);
+	Shard& shard = shardFor(k);
+	lock_guard<mutex> l(shard.x_entries);
+	if (!shard.capacity)
+		return;
+	auto it = shard.index.find(k);
+	if (it != shard.index.end())
+	{
+		it->second->second = _sender;
+		shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+		return;
+	}
+	shard.evictTo(shard.capacity - 1);
+	shard.entries.emplace_front(k, _sender);
+	shard.index.emplace(k, shard.entries.begin());
+}
+
+void SenderCache::setCapacity(size_t _capacity)
+{
+	m_capacity = _capacity;
+	for (unsigned i = 0; i < m_shardCount; ++i)
+	{
+		Shard& shard = m_shards[i];
+		lock_guard<mutex> l(shard.x_entries);
+		// Spread the remainder over the first shards so the total is exact.
+		shard.capacity = _capacity / m_shardCount + (i < _capacity % m_shardCount ? 1 : 0);
+		shard.evictTo(shard.capacity);
+	}
+}
+
+size_t SenderCache::size() const
+{
+	size_t ret = 0;
+	for (unsigned i = 0; i < m_shardCount; ++i)
+	{
+		lock_guard<mutex> l(m_shards[i].x_entries);
+		ret += m_shards[i].entries.size();
+	}
+	return ret;
+}
+
+void SenderCache::clear()
+{
+	for (unsigned i = 0; i < m_shardCount; ++i)
+	{
+		Shard& shard = m_shards[i];
+		lock_guard<mutex> l(shard.x_entries);
+		shard.index.clear();
+		shard.entries.clear();
+	}
+}
@@ -24,6 +24,7 @@
 #include <eth-crypto/core/Common.h>
 #include <eth-crypto/core/Exceptions.h>
 #include <eth-crypto/core/TransactionBase.h>
+#include <eth-crypto/core/SenderCache.h>
 //#include "EVMSchedule.h"
 #include <eth-crypto/core/sha3_wrap.h>
 
@@ -40,21 +41,23 @@ TransactionBase::TransactionBase(bytesConstRef _rlpData, CheckTransaction _check
         if (!rlp.isList())
             throw std::runtime_error("transaction RLP must be a list");
 
-        m_nonce = rlp[0].toInt<u256>();
-        m_gasPrice = rlp[1].toInt<u256>();
-        m_gas = rlp[2].toInt<u256>();
-        m_type = rlp[3].isEmpty() ? ContractCreation : MessageCall;
-        m_receiveAddress = rlp[3].isEmpty() ? Address() : rlp[3].toHash<Address>(RLP::VeryStrict);
-        m_value = rlp[4].toInt<u256>();
+        RLPIndex const fields = rlp.indexed();
 
-        if (!rlp[5].isData())
+        m_nonce = fields[0].toInt<u256>();
+        m_gasPrice = fields[1].toInt<u256>();
+        m_gas = fields[2].toInt<u256>();
+        m_type = fields[3].isEmpty() ? ContractCreation : MessageCall;
+        m_receiveAddress = fields[3].isEmpty() ? Address() : fields[3].toHash<Address>(RLP::VeryStrict);
+        m_value = fields[4].toInt<u256>();
+
+        if (!fields[5].isData())
             throw std::runtime_error("transaction data RLP must be an array");
 
-        m_data = rlp[5].toBytes();
+        m_data = fields[5].toBytes();
 
-        int const v = rlp[6].toInt<int>();
-        h256 const r = rlp[7].toInt<u256>();
-        h256 const s = rlp[8].toInt<u256>();
+        int const v = fields[6].toInt<int>();
+        h256 const r = fields[7].toInt<u256>();
+        h256 const s = fields[8].toInt<u256>();
 
         if (isZeroSignature(r, s))
         {
@@ -79,7 +82,7 @@ TransactionBase::TransactionBase(bytesConstRef _rlpData, CheckTransaction _check
         if (_checkSig == CheckTransaction::Everything)
             m_sender = sender();
 
-        if (rlp.itemCount() > 9)
+        if (fields.size() > 9)
             throw std::runtime_error("too many fields in the transaction RLP");
     }
     catch (Exception& _e)
@@ -99,12 +102,17 @@ Address const& TransactionBase::sender() const
             if (!m_vrs)
                 throw std::runtime_error("Transaction is unsigned");
 
-            auto p = recover(*m_vrs, sha3(WithoutSignature));
+            h256 const hash = sha3(WithoutSignature);
+            SenderCache& cache = SenderCache::instance();
+            if (cache.lookup(*m_vrs, hash, m_sender))
+                return m_sender;
+
+            auto p = recover(*m_vrs, hash);
             if (!p)
                 throw std::runtime_error("Invalid signature");
 
-            std::vector<unsigned char> buf(p.data(), p.data()+ p.size);
-            m_sender = right160(dev::ethash::sha3_ethash(buf));
+            m_sender = toAddress(p);
+            cache.insert(*m_vrs, hash, m_sender);
         }
     }
     return m_sender;
@@ -160,8 +168,7 @@ h256 TransactionBase::sha3(IncludeSignature _sig) const
 	RLPStream s;
 	streamRLP(s, _sig, m_chainId > 0 && _sig == WithoutSignature);
 
-    std::vector<unsigned char> buf(s.out().data(), s.out().data()+ s.out().size());
-    auto ret = dev::ethash::sha3_ethash(buf);
+    auto ret = dev::ethash::sha3_ethash(bytesConstRef(&s.out()));
 
 	if (_sig == WithSignature)
 		m_hashWith = ret;
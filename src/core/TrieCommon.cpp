@@ -0,0 +1,38 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file TrieCommon.cpp
+ * @date 2018
+ */
+
+#include <eth-crypto/core/TrieCommon.h>
+
+using namespace std;
+using namespace dev;
+
+bytes dev::hexPrefixEncode(bytesConstRef _nibbles, bool _leaf)
+{
+	bool const odd = _nibbles.size() % 2;
+	bytes ret;
+	ret.reserve(_nibbles.size() / 2 + 1);
+	ret.push_back(((_leaf ? 2 : 0) | (odd ? 1 : 0)) * 16);
+	size_t i = 0;
+	if (odd)
+		ret[0] |= _nibbles[i++];
+	for (; i < _nibbles.size(); i += 2)
+		ret.push_back(_nibbles[i] * 16 + _nibbles[i + 1]);
+	return ret;
+}
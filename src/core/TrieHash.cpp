@@ -0,0 +1,308 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file TrieHash.cpp
+ * @date 2018
+ */
+
+#include <eth-crypto/core/TrieHash.h>
+#include <eth-crypto/core/RLP.h>
+#include <eth-crypto/core/sha3_wrap.h>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+using namespace std;
+using namespace dev;
+
+namespace
+{
+
+/// Subtries with fewer leaves than this are not worth a thread.
+size_t const c_minParallelLeaves = 1024;
+
+/// An item of the trie: the nibbles of its key rlp(index) and its value.
+struct Leaf
+{
+	byte key[18];	///< rlp of a 64-bit index is at most 9 bytes.
+	unsigned size;
+	bytesConstRef value;
+};
+
+using Leaves = std::vector<Leaf>;
+using LeafIt = Leaves::const_iterator;
+
+Leaf makeLeaf(size_t _index, bytesConstRef _value)
+{
+	Leaf ret;
+	bytes const k = rlp(_index);
+	ret.size = 0;
+	for (byte b: k)
+	{
+		ret.key[ret.size++] = b >> 4;
+		ret.key[ret.size++] = b & 0x0f;
+	}
+	ret.value = _value;
+	return ret;
+}
+
+void encodeNode(LeafIt _begin, LeafIt _end, unsigned _preLen, RLPStream& o_rlp, unsigned _threads);
+
+/// @returns how node @a _node is referenced from its parent: inline if its RLP is shorter
+/// than 32 bytes, by hash otherwise.
+bytes nodeRef(bytesConstRef _node)
+{
+	if (_node.size() < 32)
+		return _node.toBytes();
+	return rlp(ethash::sha3_ethash(_node));
+}
+
+/// @returns how the node over [@a _begin, @a _end) is referenced from its parent:
+/// inline if its RLP is shorter than 32 bytes, by hash otherwise.
+bytes childRef(LeafIt _begin, LeafIt _end, unsigned _preLen, unsigned _threads)
+{
+	RLPStream node;
+	encodeNode(_begin, _end, _preLen, node, _threads);
+	if (node.out().size() < 32)
+	{
+		bytes ret;
+		node.swapOut(ret);
+		return ret;
+	}
+	return rlp(ethash::sha3_ethash(node.out()));
+}
+
+/// Appends the 16 children and the value of the branch node over [@a _begin, @a _end),
+/// whose keys all share their first @a _preLen nibbles. Children big enough get threads
+/// of their own, in proportion to their size.
+void encodeBranch(LeafIt _begin, LeafIt _end, unsigned _preLen, RLPStream& o_rlp, unsigned _threads)
+{
+	o_rlp.appendList(17);
+
+	// A key ending here is the branch's value; it sorts first.
+	LeafIt const value = _begin->size == _preLen ? _begin : _end;
+	LeafIt bounds[17];
+	bounds[0] = value == _begin ? std::next(_begin) : _begin;
+	for (byte i = 0; i < 16; ++i)
+	{
+		LeafIt n = bounds[i];
+		for (; n != _end && n->key[_preLen] == i; ++n) {}
+		bounds[i + 1] = n;
+	}
+
+	size_t const total = _end - _begin;
+	bytes children[16];
+	std::vector<std::thread> threads;
+	for (unsigned i = 0; i < 16; ++i)
+	{
+		size_t const size = bounds[i + 1] - bounds[i];
+		if (!size)
+			continue;
+		unsigned const budget = std::max<unsigned>(1, unsigned(_threads * size / total));
+		if (size >= c_minParallelLeaves && threads.size() + 1 < _threads)
+			threads.emplace_back([&, i, budget]() { children[i] = childRef(bounds[i], bounds[i + 1], _preLen + 1, budget); });
+		else
+			children[i] = childRef(bounds[i], bounds[i + 1], _preLen + 1, 1);
+	}
+	for (auto& t: threads)
+		t.join();
+
+	for (auto const& c: children)
+		if (c.empty())
+			o_rlp << "";
+		else
+			o_rlp.appendRaw(c);
+	if (value != _end)
+		o_rlp << value->value;
+	else
+		o_rlp << "";
+}
+
+/// Appends the node over the sorted leaves [@a _begin, @a _end), whose keys all share
+/// their first @a _preLen nibbles.
+void encodeNode(LeafIt _begin, LeafIt _end, unsigned _preLen, RLPStream& o_rlp, unsigned _threads)
+{
+	if (_begin == _end)
+	{
+		o_rlp << "";
+		return;
+	}
+	if (std::next(_begin) == _end)
+	{
+		o_rlp.appendList(2) << hexPrefixEncode(bytesConstRef(_begin->key + _preLen, _begin->size - _preLen), true) << _begin->value;
+		return;
+	}
+
+	// Keys are sorted, so the prefix shared by all is the one shared by the first and last.
+	LeafIt const last = std::prev(_end);
+	unsigned shared = _preLen;
+	unsigned const limit = std::min(_begin->size, last->size);
+	while (shared < limit && _begin->key[shared] == last->key[shared])
+		++shared;
+
+	if (shared > _preLen)
+	{
+		o_rlp.appendList(2) << hexPrefixEncode(bytesConstRef(_begin->key + _preLen, shared - _preLen), false);
+		o_rlp.appendRaw(childRef(_begin, _end, shared, _threads));
+	}
+	else
+		encodeBranch(_begin, _end, _preLen, o_rlp, _threads);
+}
+
+/// @returns the leaves of @a _items sorted by key.
+Leaves sortedLeaves(std::vector<bytesConstRef> const& _items)
+{
+	// rlp(i) sorts as 1...127, 0, 128... : single bytes below 0x80, then 0x80 for zero,
+	// then longer encodings whose first byte grows with the length.
+	Leaves ret;
+	ret.reserve(_items.size());
+	for (size_t i = 1; i < std::min<size_t>(_items.size(), 128); ++i)
+		ret.push_back(makeLeaf(i, _items[i]));
+	if (!_items.empty())
+		ret.push_back(makeLeaf(0, _items[0]));
+	for (size_t i = 128; i < _items.size(); ++i)
+		ret.push_back(makeLeaf(i, _items[i]));
+	return ret;
+}
+
+}
+
+h256 dev::orderedTrieRoot(std::vector<bytesConstRef> const& _items, unsigned _threads)
+{
+	if (_items.empty())
+		return EmptyTrie;
+	if (!_threads)
+		_threads = std::max(1u, std::thread::hardware_concurrency());
+
+	Leaves const leaves = sortedLeaves(_items);
+	RLPStream root;
+	encodeNode(leaves.begin(), leaves.end(), 0, root, _threads);
+	return ethash::sha3_ethash(root.out());
+}
+
+h256 dev::orderedTrieRoot(std::vector<bytes> const& _items, unsigned _threads)
+{
+	std::vector<bytesConstRef> refs;
+	refs.reserve(_items.size());
+	for (auto const& i: _items)
+		refs.push_back(&i);
+	return orderedTrieRoot(refs, _threads);
+}
+
+OrderedTrieRoot& OrderedTrieRoot::append(bytesConstRef _item)
+{
+	size_t const index = m_size++;
+	if (index == 0)
+		m_first = _item.toBytes();
+	else
+	{
+		// rlp(0) is 0x80: after 0x7f, before rlp(128) = 0x81 0x80.
+		if (index == 128)
+		{
+			insert(0, &m_first);
+			bytes().swap(m_first);
+		}
+		insert(index, _item);
+	}
+	return *this;
+}
+
+h256 OrderedTrieRoot::root() const
+{
+	if (!m_size)
+		return EmptyTrie;
+
+	OrderedTrieRoot rest(*this);
+	if (m_size <= 128)
+		rest.insert(0, &m_first);
+	return ethash::sha3_ethash(rest.collapse(0));
+}
+
+void OrderedTrieRoot::clear()
+{
+	m_size = 0;
+	m_first.clear();
+	m_path.clear();
+	m_lastKeySize = 0;
+	m_lastValue.clear();
+}
+
+void OrderedTrieRoot::insert(size_t _index, bytesConstRef _value)
+{
+	Leaf const leaf = makeLeaf(_index, _value);
+	if (m_lastKeySize)
+	{
+		// No key is a prefix of another, so the keys part at some nibble below both ends.
+		unsigned parting = 0;
+		while (leaf.key[parting] == m_lastKey[parting])
+			++parting;
+
+		// Everything under the last key's branch at the parting nibble is complete now.
+		bytes const top = collapse(parting + 1);
+		bytes const done = nodeRef(&top);
+		if (m_path.empty() || m_path.back().depth != parting)
+		{
+			m_path.emplace_back();
+			m_path.back().depth = parting;
+		}
+		m_path.back().children[m_lastKey[parting]] = done;
+	}
+	memcpy(m_lastKey, leaf.key, leaf.size);
+	m_lastKeySize = leaf.size;
+	m_lastValue.assign(_value.begin(), _value.end());
+}
+
+bytes OrderedTrieRoot::collapse(unsigned _start)
+{
+	auto const topBelow = [&]() { return !m_path.empty() && m_path.back().depth >= _start; };
+	auto const nodeStart = [&]() { return topBelow() ? m_path.back().depth + 1 : _start; };
+
+	RLPStream leaf;
+	unsigned const leafStart = nodeStart();
+	leaf.appendList(2) << hexPrefixEncode(bytesConstRef(m_lastKey + leafStart, m_lastKeySize - leafStart), true) << m_lastValue;
+	bytes node;
+	leaf.swapOut(node);
+
+	// The last key runs through every branch on the path, so it gives their slots and the
+	// nibbles of the extensions above them.
+	while (topBelow())
+	{
+		Branch& branch = m_path.back();
+		branch.children[m_lastKey[branch.depth]] = nodeRef(&node);
+		RLPStream s;
+		s.appendList(17);
+		for (auto const& c: branch.children)
+			if (c.empty())
+				s << "";
+			else
+				s.appendRaw(c);
+		s << "";
+		unsigned const depth = branch.depth;
+		m_path.pop_back();
+
+		unsigned const begin = nodeStart();
+		if (begin < depth)
+		{
+			RLPStream extension;
+			extension.appendList(2) << hexPrefixEncode(bytesConstRef(m_lastKey + begin, depth - begin), false);
+			extension.appendRaw(nodeRef(&s.out()));
+			extension.swapOut(node);
+		}
+		else
+			s.swapOut(node);
+	}
+	return node;
+}
@@ -0,0 +1,223 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file TrieProof.cpp
+ * @date 2018
+ */
+
+#include <eth-crypto/core/TrieProof.h>
+#include <eth-crypto/core/RLP.h>
+#include <eth-crypto/core/sha3_wrap.h>
+#include <unordered_map>
+
+using namespace std;
+using namespace dev;
+
+namespace
+{
+
+/// A proof node, decoded on first use so that proofs sharing it decode it once.
+struct ProofNode
+{
+	explicit ProofNode(bytesConstRef _data): data(_data) {}
+
+	RLPIndex const& items() const
+	{
+		if (!decoded)
+		{
+			index = RLP(data).indexed();
+			decoded = true;
+		}
+		return index;
+	}
+
+	bytesConstRef data;
+	mutable RLPIndex index;
+	mutable bool decoded = false;
+};
+
+/// Proof nodes by hash.
+using NodesByHash = std::unordered_map<h256, ProofNode>;
+
+/// Content hash of a node for finding duplicates before anything is Keccak hashed.
+/// Nodes below the root mostly hold hashes, so a few words of them spread well.
+struct ContentHash
+{
+	size_t operator()(bytesConstRef _d) const
+	{
+		size_t ret = _d.size();
+		uint64_t w = 0;
+		if (_d.size() >= 16)
+		{
+			memcpy(&w, _d.data() + _d.size() - 16, sizeof(w));
+			ret = ret * 1099511628211ULL ^ w;
+			memcpy(&w, _d.data() + _d.size() - 8, sizeof(w));
+			ret = ret * 1099511628211ULL ^ w;
+		}
+		else
+			for (byte b: _d)
+				ret = ret * 1099511628211ULL ^ b;
+		return ret;
+	}
+};
+
+struct ContentEqual
+{
+	bool operator()(bytesConstRef _a, bytesConstRef _b) const
+	{
+		return _a.size() == _b.size() && !memcmp(_a.data(), _b.data(), _a.size());
+	}
+};
+
+inline byte keyNibble(bytesConstRef _key, unsigned _i)
+{
+	return _i % 2 ? _key[_i / 2] & 0x0f : _key[_i / 2] >> 4;
+}
+
+/// Walks the trie below @a _root along @a _key, taking nodes from @a _nodes.
+/// @returns false if a node is missing or malformed.
+bool walk(h256 const& _root, bytesConstRef _key, NodesByHash const& _nodes, bytesConstRef& o_value)
+{
+	o_value = bytesConstRef();
+	unsigned const nibbles = _key.size() * 2;
+	unsigned pos = 0;
+
+	auto found = _nodes.find(_root);
+	if (found == _nodes.end())
+		return false;
+	RLPIndex inlined;
+	RLPIndex const* node = &found->second.items();
+	while (true)
+	{
+		RLPIndex const& items = *node;
+		size_t const count = items.size();
+
+		RLP next;
+		if (count == 17)
+		{
+			if (pos == nibbles)
+			{
+				o_value = items[16].toBytesConstRef();
+				return true;
+			}
+			next = items[keyNibble(_key, pos++)];
+		}
+		else if (count == 2)
+		{
+			// Compact path: flags nibble (leaf 2, odd 1), a nibble of padding when even.
+			bytesConstRef const path = items[0].toBytesConstRef();
+			if (path.empty() || (path[0] >> 4) > 3)
+				return false;
+			if (!(path[0] & 0x10) && (path[0] & 0x0f))
+				return false;
+			bool const leaf = path[0] & 0x20;
+			unsigned const first = path[0] & 0x10 ? 1 : 2;
+			unsigned const size = path.size() * 2 - first;
+
+			bool matches = pos + size <= nibbles;
+			for (unsigned i = 0; matches && i < size; ++i)
+				matches = keyNibble(path, first + i) == keyNibble(_key, pos + i);
+			// A diverging path proves the key is absent.
+			if (!matches)
+				return true;
+			pos += size;
+			if (leaf)
+			{
+				if (pos == nibbles)
+					o_value = items[1].toBytesConstRef();
+				return true;
+			}
+			next = items[1];
+		}
+		else
+			return false;
+
+		// Nodes shorter than a hash are inlined into their parent.
+		if (next.isList())
+		{
+			if (next.data().size() >= 32)
+				return false;
+			inlined = next.indexed();
+			node = &inlined;
+		}
+		else if (next.isEmpty())
+			return true;
+		else if (next.size() == 32)
+		{
+			found = _nodes.find(h256(next.toBytesConstRef()));
+			if (found == _nodes.end())
+				return false;
+			node = &found->second.items();
+		}
+		else
+			return false;
+	}
+}
+
+bool walkChecked(h256 const& _root, bytesConstRef _key, NodesByHash const& _nodes, bytesConstRef& o_value)
+{
+	try
+	{
+		if (walk(_root, _key, _nodes, o_value))
+			return true;
+	}
+	catch (RLPException const&)
+	{
+	}
+	o_value = bytesConstRef();
+	return false;
+}
+
+}
+
+bool dev::verifyProof(h256 const& _root, TrieProof const& _proof, bytesConstRef& o_value)
+{
+	NodesByHash nodes;
+	for (auto const& n: _proof.nodes)
+		nodes.emplace(ethash::sha3_ethash(n), ProofNode(n));
+	return walkChecked(_root, _proof.key, nodes, o_value);
+}
+
+bool dev::verifyProofs(h256 const& _root, std::vector<TrieProof> const& _proofs, std::vector<bytesConstRef>& o_values, std::vector<size_t>* o_failures)
+{
+	// Proofs against one root share their upper nodes; keep one copy of each.
+	std::unordered_map<bytesConstRef, size_t, ContentHash, ContentEqual> seen;
+	std::vector<bytesConstRef> unique;
+	for (auto const& p: _proofs)
+		for (auto const& n: p.nodes)
+			if (seen.emplace(n, unique.size()).second)
+				unique.push_back(n);
+
+	h256s hashes;
+	ethash::sha3_ethash_batch(unique, hashes);
+	NodesByHash nodes;
+	nodes.reserve(unique.size());
+	for (size_t i = 0; i < unique.size(); ++i)
+		nodes.emplace(hashes[i], ProofNode(unique[i]));
+
+	if (o_failures)
+		o_failures->clear();
+	o_values.assign(_proofs.size(), bytesConstRef());
+	bool ret = true;
+	for (size_t i = 0; i < _proofs.size(); ++i)
+		if (!walkChecked(_root, _proofs[i].key, nodes, o_values[i]))
+		{
+			ret = false;
+			if (o_failures)
+				o_failures->push_back(i);
+		}
+	return ret;
+}
@@ -0,0 +1,127 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file WorkerPool.cpp
+ * @date 2018
+ */
+
+#include <eth-crypto/core/WorkerPool.h>
+
+using namespace std;
+using namespace dev;
+
+WorkerPool& WorkerPool::instance()
+{
+	static WorkerPool s_pool;
+	return s_pool;
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		lock_guard<mutex> l(x_queue);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	for (auto& t: m_threads)
+		t.join();
+}
+
+void WorkerPool::run(size_t _count, Task const& _task)
+{
+	if (!_count)
+		return;
+
+	Batch batch{&_task, _count - 1, nullptr};
+	if (batch.pending)
+	{
+		{
+			lock_guard<mutex> l(x_queue);
+			while (m_threads.size() < batch.pending)
+				m_threads.emplace_back(&WorkerPool::workLoop, this);
+			for (size_t i = 1; i < _count; ++i)
+				m_queue.push_back(Job{&batch, i});
+		}
+		m_wake.notify_all();
+	}
+
+	try
+	{
+		_task(0);
+	}
+	catch (...)
+	{
+		batch.error = current_exception();
+	}
+
+	unique_lock<mutex> l(x_queue);
+	while (batch.pending)
+		if (!m_queue.empty())
+		{
+			Job const job = m_queue.front();
+			m_queue.pop_front();
+			l.unlock();
+			execute(job);
+			l.lock();
+		}
+		else
+			m_done.wait(l);
+	l.unlock();
+
+	if (batch.error)
+		rethrow_exception(batch.error);
+}
+
+size_t WorkerPool::size() const
+{
+	lock_guard<mutex> l(x_queue);
+	return m_threads.size();
+}
+
+void WorkerPool::workLoop()
+{
+	unique_lock<mutex> l(x_queue);
+	while (true)
+	{
+		m_wake.wait(l, [&]() { return m_stop || !m_queue.empty(); });
+		if (m_queue.empty())
+			return;
+		Job const job = m_queue.front();
+		m_queue.pop_front();
+		l.unlock();
+		execute(job);
+		l.lock();
+	}
+}
+
+void WorkerPool::execute(Job const& _job)
+{
+	exception_ptr error;
+	try
+	{
+		(*_job.batch->task)(_job.index);
+	}
+	catch (...)
+	{
+		error = current_exception();
+	}
+
+	lock_guard<mutex> l(x_queue);
+	if (error && !_job.batch->error)
+		_job.batch->error = error;
+	if (!--_job.batch->pending)
+		m_done.notify_all();
+}
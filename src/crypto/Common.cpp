@@ -23,24 +23,103 @@
 #include <eth-crypto/crypto/Common.h>
 #include <eth-crypto/core/sha3_wrap.h>
 #include <eth-crypto/core/RLP.h>
+#include <eth-crypto/core/WorkerPool.h>
 #include <secp256k1.h>
 #include <secp256k1_ecdh.h>
 #include <secp256k1_recovery.h>
+#include <atomic>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
 
 using namespace std;
 using namespace dev;
 using namespace dev::crypto;
 
-secp256k1_context const* dev::getCtx()
+namespace
 {
-	//TODO: add init_openssl function
-	static std::unique_ptr<secp256k1_context, decltype(&secp256k1_context_destroy)> s_ctx{
-		secp256k1_context_create(SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY),
-		&secp256k1_context_destroy
-	};
+
+using ContextPtr = std::unique_ptr<secp256k1_context, decltype(&secp256k1_context_destroy)>;
+
+unsigned contextFlags(ContextKind _kind)
+{
+	switch (_kind)
+	{
+	case ContextKind::Sign:
+		return SECP256K1_CONTEXT_SIGN;
+	case ContextKind::Verify:
+		return SECP256K1_CONTEXT_VERIFY;
+	default:
+		return SECP256K1_CONTEXT_SIGN | SECP256K1_CONTEXT_VERIFY;
+	}
+}
+
+/// @returns the process-wide context of the given kind that thread contexts are cloned from.
+/// It is never used for cryptographic operations itself.
+template <ContextKind _kind>
+secp256k1_context const* prototypeCtx()
+{
+	static ContextPtr s_ctx{secp256k1_context_create(contextFlags(_kind)), &secp256k1_context_destroy};
 	return s_ctx.get();
 }
 
+secp256k1_context const* prototypeCtx(ContextKind _kind)
+{
+	// One static per kind, so e.g. a verify-only process never builds signing tables.
+	switch (_kind)
+	{
+	case ContextKind::Sign:
+		return prototypeCtx<ContextKind::Sign>();
+	case ContextKind::Verify:
+		return prototypeCtx<ContextKind::Verify>();
+	default:
+		return prototypeCtx<ContextKind::Full>();
+	}
+}
+
+ContextPtr cloneCtx(ContextKind _kind)
+{
+	ContextPtr ret{secp256k1_context_clone(prototypeCtx(_kind)), &secp256k1_context_destroy};
+	// Blinding only applies to (and is only accepted by) contexts that can sign.
+	if (_kind != ContextKind::Verify)
+	{
+		h256 seed = h256::random();
+		if (!secp256k1_context_randomize(ret.get(), seed.data()))
+			BOOST_THROW_EXCEPTION(InvalidState() << errinfo_comment("secp256k1 context randomization failed"));
+		seed.ref().cleanse();
+	}
+	return ret;
+}
+
+}
+
+secp256k1_context const* dev::getCtx(ContextKind _kind)
+{
+	thread_local ContextPtr t_ctx[3] = {
+		{nullptr, &secp256k1_context_destroy},
+		{nullptr, &secp256k1_context_destroy},
+		{nullptr, &secp256k1_context_destroy}
+	};
+	ContextPtr& ctx = t_ctx[static_cast<unsigned>(_kind)];
+	if (!ctx)
+		ctx = cloneCtx(_kind);
+	return ctx.get();
+}
+
+secp256k1_context const* dev::getCtx()
+{
+	return getCtx(ContextKind::Full);
+}
+
+void dev::preloadCtx(bool _sign, bool _verify)
+{
+	if (_sign)
+		prototypeCtx(ContextKind::Sign);
+	if (_verify)
+		prototypeCtx(ContextKind::Verify);
+}
+
 bool dev::SignatureStruct::isValid() const noexcept
 {
 	static const h256 s_max{"0xfffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364141"};
@@ -51,7 +130,7 @@ bool dev::SignatureStruct::isValid() const noexcept
 
 Public dev::toPublic(Secret const& _secret)
 {
-	auto* ctx = getCtx();
+	auto* ctx = getSignCtx();
 	secp256k1_pubkey rawPubkey;
 	// Creation will fail if the secret key is invalid.
 	if (!secp256k1_ec_pubkey_create(ctx, &rawPubkey, _secret.data()))
@@ -185,39 +264,163 @@ bytesSec dev::decryptAES128CTR(bytesConstRef _k, h128 const& _iv, bytesConstRef
 	}
 }
 */
-Public dev::recover(Signature const& _sig, h256 const& _message)
+namespace
+{
+
+/// Minimal number of signatures handed to a single recoverBatch worker.
+size_t const c_minRecoverBatchPerThread = 64;
+
+RecoverResult recoverWith(secp256k1_context const* _ctx, Signature const& _sig, h256 const& _message, Public& o_public)
 {
 	int v = _sig[64];
 	if (v > 3)
-		return {};
+		return RecoverResult::InvalidRecoveryId;
 
-	auto* ctx = getCtx();
 	secp256k1_ecdsa_recoverable_signature rawSig;
-	if (!secp256k1_ecdsa_recoverable_signature_parse_compact(ctx, &rawSig, _sig.data(), v))
-		return {};
+	if (!secp256k1_ecdsa_recoverable_signature_parse_compact(_ctx, &rawSig, _sig.data(), v))
+		return RecoverResult::InvalidSignature;
 
 	secp256k1_pubkey rawPubkey;
-	if (!secp256k1_ecdsa_recover(ctx, &rawPubkey, &rawSig, _message.data()))
-		return {};
+	if (!secp256k1_ecdsa_recover(_ctx, &rawPubkey, &rawSig, _message.data()))
+		return RecoverResult::NoPublicKey;
 
 	std::array<byte, 65> serializedPubkey;
 	size_t serializedPubkeySize = serializedPubkey.size();
 	secp256k1_ec_pubkey_serialize(
-			ctx, serializedPubkey.data(), &serializedPubkeySize,
+			_ctx, serializedPubkey.data(), &serializedPubkeySize,
 			&rawPubkey, SECP256K1_EC_UNCOMPRESSED
 	);
 	assert(serializedPubkeySize == serializedPubkey.size());
 	// Expect single byte header of value 0x04 -- uncompressed public key.
 	assert(serializedPubkey[0] == 0x04);
 	// Create the Public skipping the header.
-	return Public{&serializedPubkey[1], Public::ConstructFromPointer};
+	o_public = Public{&serializedPubkey[1], Public::ConstructFromPointer};
+	return RecoverResult::Ok;
+}
+
+/// Parses the 64-byte @a _p into the secp256k1 internal representation.
+/// @returns false if @a _p is not a point on the curve.
+bool parsePublic(secp256k1_context const* _ctx, Public const& _p, secp256k1_pubkey& o_pubkey)
+{
+	std::array<byte, 65> serializedPubkey{{0x04}};
+	std::copy(_p.asArray().begin(), _p.asArray().end(), serializedPubkey.begin() + 1);
+	return secp256k1_ec_pubkey_parse(_ctx, &o_pubkey, serializedPubkey.data(), serializedPubkey.size());
+}
+
+/// Checks the ECDSA signature @a _sig of @a _hash against an already parsed public key.
+/// The recovery id is only range-checked since no point is recovered.
+bool verifyWith(secp256k1_context const* _ctx, secp256k1_pubkey const& _pubkey, Signature const& _sig, h256 const& _hash)
+{
+	if (_sig[64] > 3)
+		return false;
+
+	secp256k1_ecdsa_signature rawSig;
+	if (!secp256k1_ecdsa_signature_parse_compact(_ctx, &rawSig, _sig.data()))
+		return false;
+	// Recovery accepts both s and n - s; secp256k1_ecdsa_verify only accepts the lower one.
+	secp256k1_ecdsa_signature_normalize(_ctx, &rawSig, &rawSig);
+	return secp256k1_ecdsa_verify(_ctx, &rawSig, _hash.data(), &_pubkey);
+}
+
+}
+
+Public dev::recover(Signature const& _sig, h256 const& _message)
+{
+	Public ret;
+	if (recoverWith(getVerifyCtx(), _sig, _message, ret) != RecoverResult::Ok)
+		return {};
+	return ret;
+}
+
+namespace
+{
+
+/// @returns the number of workers a batch of @a _count items is split across
+/// when at most @a _threads threads may be used (0 means one per hardware thread).
+size_t batchWorkers(size_t _count, unsigned _threads)
+{
+	if (!_threads)
+		_threads = std::max(1u, std::thread::hardware_concurrency());
+	return std::min<size_t>(_threads, (_count + c_minRecoverBatchPerThread - 1) / c_minRecoverBatchPerThread);
+}
+
+/// Splits [0, @a _count) into @a _workers contiguous ranges and runs @a _work(worker, begin, end)
+/// for each of them on the worker pool, whose threads keep their secp256k1 contexts between
+/// batches. The calling thread works on the first range.
+template <class Work>
+void runBatch(size_t _count, size_t _workers, Work const& _work)
+{
+	WorkerPool::instance().run(_workers, [&](size_t _worker)
+	{
+		_work(_worker, _count * _worker / _workers, _count * (_worker + 1) / _workers);
+	});
+}
+
+/// Shared driver of the verifyBatch overloads; @a _check(ctx, i) verifies item i.
+template <class Check>
+bool verifyBatchWith(size_t _count, std::vector<size_t>* o_failures, unsigned _threads, Check const& _check)
+{
+	if (o_failures)
+		o_failures->clear();
+
+	// All-or-nothing callers only need to know that something failed, so every worker
+	// stops as soon as any of them finds a bad item.
+	std::atomic<bool> failed{false};
+	size_t const workers = batchWorkers(_count, _threads);
+	std::vector<std::vector<size_t>> failures(workers);
+	runBatch(_count, workers, [&](size_t _worker, size_t _begin, size_t _end)
+	{
+		auto* ctx = getVerifyCtx();
+		for (size_t i = _begin; i < _end; ++i)
+		{
+			if (!o_failures && failed.load(std::memory_order_relaxed))
+				return;
+			if (!_check(ctx, i))
+			{
+				failed = true;
+				if (o_failures)
+					failures[_worker].push_back(i);
+			}
+		}
+	});
+
+	// Workers cover ascending ranges, so concatenating keeps the indices sorted.
+	if (o_failures)
+		for (auto const& f: failures)
+			o_failures->insert(o_failures->end(), f.begin(), f.end());
+	return !failed;
+}
+
+}
+
+size_t dev::recoverBatch(Signatures const& _sigs, h256s const& _hashes, Publics& o_publics, RecoverResults& o_results, unsigned _threads)
+{
+	if (_sigs.size() != _hashes.size())
+		throw std::invalid_argument("recoverBatch: signature and hash counts differ");
+
+	size_t const count = _sigs.size();
+	o_publics.assign(count, Public());
+	o_results.assign(count, RecoverResult::Ok);
+
+	size_t const workers = batchWorkers(count, _threads);
+	std::vector<size_t> failures(workers, 0);
+	runBatch(count, workers, [&](size_t _worker, size_t _begin, size_t _end)
+	{
+		// Contexts are per thread, so each worker uses its own one.
+		auto* ctx = getVerifyCtx();
+		for (size_t i = _begin; i < _end; ++i)
+			if ((o_results[i] = recoverWith(ctx, _sigs[i], _hashes[i], o_publics[i])) != RecoverResult::Ok)
+				++failures[_worker];
+	});
+
+	return std::accumulate(failures.begin(), failures.end(), size_t(0));
 }
 
 static const u256 c_secp256k1n("115792089237316195423570985008687907852837564279074904382605163141518161494337");
 
 Signature dev::sign(Secret const& _k, h256 const& _hash)
 {
-	auto* ctx = getCtx();
+	auto* ctx = getSignCtx();
 	secp256k1_ecdsa_recoverable_signature rawSig;
 	if (!secp256k1_ecdsa_sign_recoverable(ctx, &rawSig, _hash.data(), _k.data(), nullptr, nullptr))
 		return {};
@@ -236,12 +439,66 @@ Signature dev::sign(Secret const& _k, h256 const& _hash)
 	return s;
 }
 
+ParsedPublic::ParsedPublic(Public const& _p):
+	m_public(_p)
+{
+	m_valid = _p && parsePublic(getVerifyCtx(), _p, m_raw);
+}
+
 bool dev::verify(Public const& _p, Signature const& _s, h256 const& _hash)
 {
-	// TODO: Verify w/o recovery (if faster).
+	return verify(ParsedPublic(_p), _s, _hash);
+}
+
+bool dev::verify(ParsedPublic const& _p, Signature const& _s, h256 const& _hash)
+{
 	if (!_p)
 		return false;
-	return _p == recover(_s, _hash);
+	return verifyWith(getVerifyCtx(), _p.raw(), _s, _hash);
+}
+
+bool dev::verify(Address const& _a, Signature const& _s, h256 const& _hash)
+{
+	// Only the address is known, so the public key has to be recovered.
+	if (!_a)
+		return false;
+	Public const p = recover(_s, _hash);
+	return p && toAddress(p) == _a;
+}
+
+bool dev::verifyBatch(Signatures const& _sigs, h256s const& _hashes, Publics const& _publics, std::vector<size_t>* o_failures, unsigned _threads)
+{
+	if (_sigs.size() != _hashes.size() || _sigs.size() != _publics.size())
+		throw std::invalid_argument("verifyBatch: signature, hash and key counts differ");
+
+	return verifyBatchWith(_sigs.size(), o_failures, _threads, [&](secp256k1_context const* _ctx, size_t _i)
+	{
+		secp256k1_pubkey pubkey;
+		return _publics[_i] && parsePublic(_ctx, _publics[_i], pubkey) && verifyWith(_ctx, pubkey, _sigs[_i], _hashes[_i]);
+	});
+}
+
+bool dev::verifyBatch(Signatures const& _sigs, h256s const& _hashes, ParsedPublics const& _publics, std::vector<size_t>* o_failures, unsigned _threads)
+{
+	if (_sigs.size() != _hashes.size() || _sigs.size() != _publics.size())
+		throw std::invalid_argument("verifyBatch: signature, hash and key counts differ");
+
+	return verifyBatchWith(_sigs.size(), o_failures, _threads, [&](secp256k1_context const* _ctx, size_t _i)
+	{
+		return _publics[_i] && verifyWith(_ctx, _publics[_i].raw(), _sigs[_i], _hashes[_i]);
+	});
+}
+
+bool dev::verifyBatch(Signatures const& _sigs, h256s const& _hashes, Addresses const& _addresses, std::vector<size_t>* o_failures, unsigned _threads)
+{
+	if (_sigs.size() != _hashes.size() || _sigs.size() != _addresses.size())
+		throw std::invalid_argument("verifyBatch: signature, hash and address counts differ");
+
+	return verifyBatchWith(_sigs.size(), o_failures, _threads, [&](secp256k1_context const* _ctx, size_t _i)
+	{
+		Public p;
+		return _addresses[_i] && recoverWith(_ctx, _sigs[_i], _hashes[_i], p) == RecoverResult::Ok && toAddress(p) == _addresses[_i];
+	});
 }
 /*
 bytesSec dev::pbkdf2(string const& _pass, bytes const& _salt, unsigned _iterations, unsigned _dkLen)
@@ -297,6 +554,116 @@ KeyPair KeyPair::create()
 			return keyPair;
 	}
 }
+
+namespace
+{
+
+/// Number of keys generateAddresses() derives in memory before appending them to a file.
+size_t const c_keyGenFileChunk = 1 << 20;
+
+/// Number of public keys deriveAddresses() collects before hashing them in one batch.
+size_t const c_keyGenHashBatch = 256;
+
+/// Writes the addresses of the secrets @a _first, @a _first + 1, ... to @a o_out[0, _count).
+/// Only the first public key costs a scalar multiplication, every other one is
+/// obtained by adding the generator to its predecessor. Keys are hashed in batches.
+void deriveAddresses(Secret const& _first, Address* o_out, size_t _count)
+{
+	auto* ctx = getSignCtx();
+	// G itself is the public key of the secret 1.
+	static secp256k1_pubkey const s_generator = []
+	{
+		secp256k1_pubkey ret;
+		Secret one(h256(1));
+		if (!secp256k1_ec_pubkey_create(getSignCtx(), &ret, one.data()))
+			BOOST_THROW_EXCEPTION(InvalidState() << errinfo_comment("secp256k1 generator point creation failed"));
+		return ret;
+	}();
+
+	secp256k1_pubkey point;
+	if (!secp256k1_ec_pubkey_create(ctx, &point, _first.data()))
+		BOOST_THROW_EXCEPTION(InvalidState() << errinfo_comment("invalid first secret"));
+
+	// Serialized keys of the current batch, each with its 0x04 header; the header is not hashed.
+	size_t const batch = std::min(_count, c_keyGenHashBatch);
+	bytes serialized(65 * batch);
+	std::vector<bytesConstRef> keys(batch);
+	for (size_t k = 0; k < batch; ++k)
+		keys[k] = bytesConstRef(serialized.data() + 65 * k + 1, 64);
+	h256s hashes(batch);
+
+	for (size_t i = 0; i < _count; ++i)
+	{
+		if (i)
+		{
+			// The output must not alias the inputs of secp256k1_ec_pubkey_combine.
+			secp256k1_pubkey next;
+			secp256k1_pubkey const* terms[2] = {&point, &s_generator};
+			if (!secp256k1_ec_pubkey_combine(ctx, &next, terms, 2))
+				BOOST_THROW_EXCEPTION(InvalidState() << errinfo_comment("secret range wraps around the group order"));
+			point = next;
+		}
+		size_t const k = i % batch;
+		size_t serializedPubkeySize = 65;
+		secp256k1_ec_pubkey_serialize(
+				ctx, serialized.data() + 65 * k, &serializedPubkeySize,
+				&point, SECP256K1_EC_UNCOMPRESSED
+		);
+		if (k + 1 == batch || i + 1 == _count)
+		{
+			size_t const n = k + 1;
+			ethash::sha3_ethash_batch(keys.data(), hashes.data(), n);
+			for (size_t j = 0; j < n; ++j)
+				o_out[i + 1 - n + j] = right160(hashes[j]);
+		}
+	}
+}
+
+/// Throws unless every secret in [@a _first, @a _first + @a _count) is a valid key.
+void requireKeyRange(Secret const& _first, size_t _count)
+{
+	u256 const first = u256(_first.makeInsecure());
+	if (!first || first >= c_secp256k1n || c_secp256k1n - first < _count)
+		throw std::invalid_argument("generateAddresses: secret range is not within [1, n)");
+}
+
+}
+
+KeyGenStats dev::generateAddresses(Secret const& _first, size_t _count, Addresses& o_addresses, unsigned _threads)
+{
+	requireKeyRange(_first, _count);
+	Timer timer;
+	o_addresses.resize(_count);
+
+	u256 const first = u256(_first.makeInsecure());
+	runBatch(_count, batchWorkers(_count, _threads), [&](size_t, size_t _begin, size_t _end)
+	{
+		deriveAddresses(Secret(h256(first + _begin)), o_addresses.data() + _begin, _end - _begin);
+	});
+
+	return KeyGenStats{_count, timer.elapsed()};
+}
+
+KeyGenStats dev::generateAddresses(Secret const& _first, size_t _count, boost::filesystem::path const& _file, unsigned _threads)
+{
+	requireKeyRange(_first, _count);
+	Timer timer;
+	std::ofstream out(_file.string(), std::ios::binary | std::ios::trunc);
+	if (!out)
+		throw std::runtime_error("generateAddresses: cannot open " + _file.string());
+
+	u256 const first = u256(_first.makeInsecure());
+	Addresses chunk;
+	for (size_t done = 0; done < _count; done += chunk.size())
+	{
+		generateAddresses(Secret(h256(first + done)), std::min(c_keyGenFileChunk, _count - done), chunk, _threads);
+		out.write(reinterpret_cast<char const*>(chunk.data()), chunk.size() * sizeof(Address));
+	}
+	if (!out.flush())
+		throw std::runtime_error("generateAddresses: cannot write " + _file.string());
+
+	return KeyGenStats{_count, timer.elapsed()};
+}
 /*
 KeyPair KeyPair::fromEncryptedSeed(bytesConstRef _seed, std::string const& _password)
 {
@@ -315,10 +682,10 @@ h256 crypto::kdf(Secret const& _priv, h256 const& _hash)
 		BOOST_THROW_EXCEPTION(InvalidState());
 	return s;
 }
-
+*/
 Secret Nonce::next()
 {
-//	Guard l(x_value);
+	std::lock_guard<std::mutex> l(x_value);
 	if (!m_value)
 	{
 		m_value = Secret::random();
@@ -326,22 +693,22 @@ Secret Nonce::next()
 			BOOST_THROW_EXCEPTION(InvalidState());
 	}
 	m_value = dev::openssl::sha3Secure(m_value.ref());
-	return  dev::ethash::sha3_ethash(~m_value);
+	return Secret(dev::ethash::sha3_ethash((~m_value).makeInsecure()));
 }
-*/
+
 bool ecdh::agree(Secret const& _s, Public const& _r, Secret& o_s) noexcept
 {
-	auto* ctx = getCtx();
-	static_assert(sizeof(Secret) == 32, "Invalid Secret type size");
-	secp256k1_pubkey rawPubkey;
-	std::array<byte, 65> serializedPubKey{{0x04}};
-	std::copy(_r.asArray().begin(), _r.asArray().end(), serializedPubKey.begin() + 1);
-	if (!secp256k1_ec_pubkey_parse(ctx, &rawPubkey, serializedPubKey.data(), serializedPubKey.size()))
+	return agree(_s, ParsedPublic(_r), o_s);
+}
+
+bool ecdh::agree(Secret const& _s, ParsedPublic const& _r, Secret& o_s) noexcept
+{
+	if (!_r)
 		return false;  // Invalid public key.
-	// FIXME: We should verify the public key when constructed, maybe even keep
-	//        secp256k1_pubkey as the internal data of Public.
+	auto* ctx = getVerifyCtx();
+	static_assert(sizeof(Secret) == 32, "Invalid Secret type size");
 	std::array<byte, 32> compressedPoint;
-	if (!secp256k1_ecdh(ctx, compressedPoint.data(), &rawPubkey, _s.data(), NULL, NULL))
+	if (!secp256k1_ecdh(ctx, compressedPoint.data(), &_r.raw(), _s.data(), NULL, NULL))
 		return false;  // Invalid secret key.
 	std::copy(compressedPoint.begin(), compressedPoint.end(), o_s.writable().data());
 	return true;
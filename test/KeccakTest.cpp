@@ -0,0 +1,187 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file KeccakTest.cpp
+ * @date 2018
+ *
+ * Keccak-256 known-answer vectors, and checks that every way of hashing agrees with them
+ * on every Keccak backend the host can run.
+ * Reports every mismatch and exits non-zero if there was one; run by ctest when ETH_CRYPTO_TESTS is on.
+ */
+
+#include <eth-crypto/core/CommonIO.h>
+#include <eth-crypto/core/sha3_wrap.h>
+#include <iostream>
+
+using namespace std;
+using namespace dev;
+
+namespace
+{
+
+struct Vector
+{
+	size_t size;	///< Input length; inputs are "abc"-style text or the bytes 0, 1, 2, ...
+	char const* text;
+	char const* hash;
+};
+
+/// Lengths straddle the 136-byte rate, so the tail, full-block and two-block paths are all covered.
+Vector const c_vectors[] = {
+	{0, "", "c5d2460186f7233c927e7db2dcc703c0e500b653ca82273b7bfad8045d85a470"},
+	{3, "abc", "4e03657aea45a94fc7d47ba826c8d667c0d1e6e33a64a036ec44f58fa12d6c45"},
+	{43, "The quick brown fox jumps over the lazy dog", "4d741b6f1eb29cb2a9b9911c82f56fa8d73b04959d3d9d222895df6c0b28aa15"},
+	{170, "function multicall(bytes[] calldata data) external returns (bytes[] memory results); "
+		"function multicall(bytes[] calldata data) external returns (bytes[] memory results); ",
+		"bb359e552a0264cc7a8218245990e05ca8abc819c2246747880fc2c5219e9b32"},
+	{135, nullptr, "cbdfd9dee5faad3818d6b06f95a219fd290b0e1706f6a82e5a595b9ce9faca62"},
+	{136, nullptr, "7ce759f1ab7f9ce437719970c26b0a66ff11fe3e38e17df89cf5d29c7d7f807e"},
+	{137, nullptr, "ac73d4fae68b8453f764007c1a20ce95994187861f0c3227a3a8e99a73a3b1db"},
+	{272, nullptr, "fdf2ec49e749960d3c8521a0219af8d03e30e2b3bf19bd16150ee0eaf133d66e"},
+	{300, nullptr, "a679e749a6af300c36e7ff2255d220864eab27b382f9cfdc5aa4d13563ba36ff"},
+};
+
+bytes input(Vector const& _v)
+{
+	if (_v.text)
+		return asBytes(_v.text);
+	bytes ret(_v.size);
+	for (size_t i = 0; i < ret.size(); ++i)
+		ret[i] = byte(i);
+	return ret;
+}
+
+/// Deterministic inputs of every length from 0 to @a _count - 1.
+vector<bytes> patternInputs(size_t _count)
+{
+	vector<bytes> ret(_count);
+	for (size_t i = 0; i < _count; ++i)
+		for (size_t j = 0; j < i; ++j)
+			ret[i].push_back(byte(i * 31 + j * 7));
+	return ret;
+}
+
+unsigned s_failures = 0;
+string s_backend;	///< Keccak backend the checks currently run on.
+
+void expect(bool _ok, string const& _what)
+{
+	if (!_ok)
+	{
+		cerr << "FAILED [" << s_backend << "]: " << _what << endl;
+		++s_failures;
+	}
+}
+
+void testKnownAnswers()
+{
+	for (auto const& v: c_vectors)
+		expect(ethash::sha3_ethash(input(v)) == h256(v.hash), "sha3_ethash of " + toString(v.size) + " bytes");
+}
+
+/// Batches of every size up to 17 leave every possible remainder after 4- and 8-way groups.
+void testBatch()
+{
+	vector<bytes> const data = patternInputs(300);
+	for (size_t count = 0; count <= 17; ++count)
+		for (size_t first = 0; first + count <= data.size(); first += 61)
+		{
+			vector<bytesConstRef> refs;
+			for (size_t i = first; i < first + count; ++i)
+				refs.push_back(&data[i]);
+			h256s hashes;
+			ethash::sha3_ethash_batch(refs, hashes);
+			for (size_t i = 0; i < count; ++i)
+				expect(hashes[i] == ethash::sha3_ethash(refs[i]), "batch of " + toString(count) + ", input " + toString(first + i));
+		}
+
+	vector<bytes> owned;
+	for (auto const& v: c_vectors)
+		owned.push_back(input(v));
+	vector<bytesConstRef> refs;
+	for (auto const& o: owned)
+		refs.push_back(&o);
+	h256s hashes;
+	ethash::sha3_ethash_batch(refs, hashes);
+	for (size_t i = 0; i < owned.size(); ++i)
+		expect(hashes[i] == h256(c_vectors[i].hash), "batched known answer " + toString(c_vectors[i].size));
+}
+
+/// Feeds each vector to one Keccak256 in chunks of several sizes, relying on final() to reset it.
+void testIncremental()
+{
+	Keccak256 hasher;
+	for (auto const& v: c_vectors)
+	{
+		bytes const data = input(v);
+		for (size_t chunk: {1, 7, 64, 135, 136, 137})
+		{
+			for (size_t done = 0; done < data.size(); done += chunk)
+				hasher.update(bytesConstRef(&data).cropped(done, min(chunk, data.size() - done)));
+			expect(hasher.final() == h256(v.hash), "Keccak256 over " + toString(v.size) + " bytes in chunks of " + toString(chunk));
+		}
+	}
+
+	bytes const discarded = asBytes("discarded");
+	hasher.update(&discarded);
+	hasher.reset();
+	expect(hasher.update(h256()).final() == ethash::sha3_ethash(h256().asBytes()), "Keccak256 after reset()");
+}
+
+/// constSha3() and friends, evaluated by the compiler and at run time.
+void testConstant()
+{
+	constexpr h256 c_topic = constSha3("Transfer(address,address,uint256)");
+	constexpr h256 c_topicLiteral = "Transfer(address,address,uint256)"_sha3;
+	constexpr h32 c_selector = constSelector("transfer(address,uint256)");
+	constexpr h32 c_selectorLiteral = "transfer(address,uint256)"_selector;
+	constexpr h256 c_multiBlock = "function multicall(bytes[] calldata data) external returns (bytes[] memory results); "
+		"function multicall(bytes[] calldata data) external returns (bytes[] memory results); "_sha3;
+	h256 const topic("ddf252ad1be2c89b69c2b068fc378daa952ba7f163c4a11628f55a4df523b3ef");
+	expect(c_topic == topic, "constSha3 of a string literal");
+	expect(c_topicLiteral == topic, "_sha3 literal");
+	expect(c_selector == h32("a9059cbb"), "constSelector");
+	expect(c_selectorLiteral == h32("a9059cbb"), "_selector literal");
+	expect(c_multiBlock == h256("bb359e552a0264cc7a8218245990e05ca8abc819c2246747880fc2c5219e9b32"), "_sha3 literal over two blocks");
+
+	for (auto const& v: c_vectors)
+		if (v.text)
+			expect(constSha3(v.text, v.size) == h256(v.hash), "constSha3 of " + toString(v.size) + " bytes");
+}
+
+}
+
+int main()
+{
+	s_backend = "constexpr";
+	testConstant();
+
+	// Every backend must give the same answers; batch-only ones serve sha3_ethash_batch()
+	// while single inputs stay on the last single-state backend selected.
+	for (auto const& name: keccak::availableBackends())
+	{
+		s_backend = name;
+		expect(keccak::selectBackend(name) && keccak::activeBatchBackend() == name, "selectBackend");
+		testKnownAnswers();
+		testBatch();
+		testIncremental();
+	}
+	s_backend = "all";
+	expect(!keccak::selectBackend("no-such-backend"), "selectBackend of an unknown name");
+	if (s_failures)
+		cerr << s_failures << " check(s) failed" << endl;
+	return s_failures ? 1 : 0;
+}